@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
+#include "neander.h"
 
 #define HEADER_SIZE 4
 #define MEMORY_SIZE 512
@@ -34,11 +35,16 @@ typedef struct
     int memoryAddr;
     int initialValue;
     bool isDefined;
+    bool isCode;
 } Symbol;
 
-#define MAX_LABEL_COUNT 256
-Symbol labelTable[MAX_LABEL_COUNT];
+Symbol *labelTable = NULL;
 int labelTotal = 0;
+int labelCapacity = 0;
+
+bool compactOutput = false;
+bool emitSymbols = false;
+bool extendedMode = false;
 
 /**
  * registerSymbol – registra um símbolo na tabela
@@ -51,13 +57,24 @@ int labelTotal = 0;
  */
 void registerSymbol(const char *name, int addr, int value, bool defined)
 {
-    if (labelTotal < MAX_LABEL_COUNT)
+    if (labelTotal == labelCapacity)
+    {
+        int newCapacity = labelCapacity ? labelCapacity * 2 : 256;
+        Symbol *grown = realloc(labelTable, newCapacity * sizeof(Symbol));
+        if (grown)
+        {
+            labelTable = grown;
+            labelCapacity = newCapacity;
+        }
+    }
+    if (labelTotal < labelCapacity)
     {
         strncpy(labelTable[labelTotal].labelName, name, sizeof(labelTable[labelTotal].labelName) - 1);
         labelTable[labelTotal].labelName[sizeof(labelTable[labelTotal].labelName) - 1] = '\0';
         labelTable[labelTotal].memoryAddr = addr;
         labelTable[labelTotal].initialValue = value;
         labelTable[labelTotal].isDefined = defined;
+        labelTable[labelTotal].isCode = false;
         labelTotal++;
         printf("Simbolo registrado: %s (address: %d, value: %d)\n", name, addr, value);
     }
@@ -128,6 +145,526 @@ void removeCommentsAndTrim(char *line)
         line[--len] = '\0';
 }
 
+/**
+ * SourceLines – linhas do fonte já pré-processadas (sem comentários, macros expandidas)
+ */
+typedef struct
+{
+    char **lines;
+    int count;
+    int capacity;
+} SourceLines;
+
+/**
+ * appendLine – acrescenta cópia de uma linha ao buffer
+ * @src: buffer de linhas
+ * @text: linha a copiar
+ *
+ * @return: true se sucesso, false se faltar memória
+ */
+bool appendLine(SourceLines *src, const char *text)
+{
+    if (src->count == src->capacity)
+    {
+        int newCapacity = src->capacity ? src->capacity * 2 : 64;
+        char **grown = realloc(src->lines, newCapacity * sizeof(char *));
+        if (!grown)
+            return false;
+        src->lines = grown;
+        src->capacity = newCapacity;
+    }
+    src->lines[src->count] = strdup(text);
+    if (!src->lines[src->count])
+        return false;
+    src->count++;
+    return true;
+}
+
+/**
+ * freeSourceLines – libera buffer de linhas
+ */
+void freeSourceLines(SourceLines *src)
+{
+    for (int i = 0; i < src->count; i++)
+        free(src->lines[i]);
+    free(src->lines);
+    src->lines = NULL;
+    src->count = src->capacity = 0;
+}
+
+#define MAX_MACRO_PARAMS 8
+#define MAX_MACRO_DEPTH 16
+
+/**
+ * Macro – macro de montagem com parâmetros e rótulos locais (prefixo %%)
+ */
+typedef struct
+{
+    char name[32];
+    char params[MAX_MACRO_PARAMS][32];
+    int paramCount;
+    SourceLines body;
+} Macro;
+
+Macro *macroTable = NULL;
+int macroTotal = 0;
+int macroCapacity = 0;
+Macro *definingMacro = NULL;
+int macroExpansionCount = 0;
+bool preprocessInCode = false; /* macros só são chamadas no lugar da instrução, em .CODE */
+
+/*
+ * Biblioteca embutida de rotinas aritméticas. Todas trabalham em 8 bits sem
+ * sinal, usam apenas instruções do Neander e têm número fixo de iterações
+ * (no máximo 8), independente dos valores dos operandos.
+ */
+static const char *builtinMacroLibrary[] = {
+    /* SHL x – x = x << 1 */
+    ".MACRO SHL x",
+    "LDA x",
+    "ADD x",
+    "STA x",
+    ".ENDM",
+
+    /* SHR x – x = x >> 1 (lógico): remonta os bits 7..1 de x, 7 iterações */
+    ".MACRO SHR x",
+    ".DATA",
+    "%%v DB 0",
+    "%%r DB 0",
+    "%%cnt DB 0",
+    "%%one DB 1",
+    "%%seven DB 7",
+    ".CODE",
+    "LDA x",
+    "STA %%v",
+    "SUB x",
+    "STA %%r",
+    "LDA %%seven",
+    "STA %%cnt",
+    "%%loop:",
+    "LDA %%r",
+    "ADD %%r",
+    "STA %%r",
+    "LDA %%v",
+    "JMN %%bit",
+    "JMP %%next",
+    "%%bit:",
+    "LDA %%r",
+    "ADD %%one",
+    "STA %%r",
+    "%%next:",
+    "LDA %%v",
+    "ADD %%v",
+    "STA %%v",
+    "LDA %%cnt",
+    "SUB %%one",
+    "STA %%cnt",
+    "JMZ %%done",
+    "JMP %%loop",
+    "%%done:",
+    "LDA %%r",
+    "STA x",
+    ".ENDM",
+
+    /* MUL8 a, b, dst – dst = a * b (mod 256): desloca e soma, bits de b do mais
+     * significativo ao menos significativo, 8 iterações */
+    ".MACRO MUL8 a, b, dst",
+    ".DATA",
+    "%%n DB 0",
+    "%%acc DB 0",
+    "%%cnt DB 0",
+    "%%one DB 1",
+    "%%eight DB 8",
+    ".CODE",
+    "LDA b",
+    "STA %%n",
+    "SUB b",
+    "STA %%acc",
+    "LDA %%eight",
+    "STA %%cnt",
+    "%%loop:",
+    "LDA %%acc",
+    "ADD %%acc",
+    "STA %%acc",
+    "LDA %%n",
+    "JMN %%add",
+    "JMP %%next",
+    "%%add:",
+    "LDA %%acc",
+    "ADD a",
+    "STA %%acc",
+    "%%next:",
+    "LDA %%n",
+    "ADD %%n",
+    "STA %%n",
+    "LDA %%cnt",
+    "SUB %%one",
+    "STA %%cnt",
+    "JMZ %%done",
+    "JMP %%loop",
+    "%%done:",
+    "LDA %%acc",
+    "STA dst",
+    ".ENDM",
+
+    /* DIVMOD8 a, b, q, r – q = a / b, r = a % b: divisão restauradora, 8 iterações.
+     * Divisão por zero termina com q = 0 e r = a, como x / 0 = 0 no compilador. */
+    ".MACRO DIVMOD8 a, b, q, r",
+    ".DATA",
+    "%%n DB 0",
+    "%%r DB 0",
+    "%%q DB 0",
+    "%%cnt DB 0",
+    "%%one DB 1",
+    "%%eight DB 8",
+    ".CODE",
+    "LDA a",
+    "STA %%n",
+    "SUB a",
+    "STA %%r",
+    "STA %%q",
+    "LDA b",
+    "JMZ %%zero",
+    "LDA %%eight",
+    "STA %%cnt",
+    "%%loop:",
+    "LDA %%q",
+    "ADD %%q",
+    "STA %%q",
+    "LDA %%r",
+    "JMN %%over",
+    "ADD %%r",
+    "STA %%r",
+    "LDA %%n",
+    "JMN %%bit",
+    "JMP %%cmp",
+    "%%bit:",
+    "LDA %%r",
+    "ADD %%one",
+    "STA %%r",
+    /* r >= b sem sinal: compara bits altos e, se iguais, o sinal da diferença */
+    "%%cmp:",
+    "LDA %%r",
+    "JMN %%rhigh",
+    "LDA b",
+    "JMN %%next",
+    "JMP %%diff",
+    "%%rhigh:",
+    "LDA b",
+    "JMN %%diff",
+    "JMP %%sub",
+    "%%diff:",
+    "LDA %%r",
+    "SUB b",
+    "JMN %%next",
+    "JMP %%sub",
+    /* bit 7 de r saiu no deslocamento: resto parcial >= 256 > b */
+    "%%over:",
+    "ADD %%r",
+    "STA %%r",
+    "LDA %%n",
+    "JMN %%obit",
+    "JMP %%sub",
+    "%%obit:",
+    "LDA %%r",
+    "ADD %%one",
+    "STA %%r",
+    "%%sub:",
+    "LDA %%r",
+    "SUB b",
+    "STA %%r",
+    "LDA %%q",
+    "ADD %%one",
+    "STA %%q",
+    "%%next:",
+    "LDA %%n",
+    "ADD %%n",
+    "STA %%n",
+    "LDA %%cnt",
+    "SUB %%one",
+    "STA %%cnt",
+    "JMZ %%done",
+    "JMP %%loop",
+    "%%zero:",
+    "LDA %%n",
+    "STA %%r",
+    "%%done:",
+    "LDA %%q",
+    "STA q",
+    "LDA %%r",
+    "STA r",
+    ".ENDM",
+    NULL};
+
+/**
+ * findMacro – procura macro pelo nome (sem distinção de caixa)
+ *
+ * @return: ponteiro para a macro ou NULL
+ */
+Macro *findMacro(const char *name)
+{
+    for (int i = 0; i < macroTotal; i++)
+    {
+        if (strcasecmp(macroTable[i].name, name) == 0)
+            return &macroTable[i];
+    }
+    return NULL;
+}
+
+/**
+ * splitOperands – separa lista de operandos por vírgulas e/ou espaços
+ * @text: texto após o nome da macro
+ * @out: vetor de destino
+ * @max: capacidade de out
+ *
+ * @return: número de operandos encontrados (pode exceder max)
+ */
+int splitOperands(const char *text, char out[][32], int max)
+{
+    int count = 0;
+    while (*text)
+    {
+        while (*text == ',' || isspace((unsigned char)*text))
+            text++;
+        if (*text == '\0')
+            break;
+        int len = 0;
+        char item[32];
+        while (*text && *text != ',' && !isspace((unsigned char)*text))
+        {
+            if (len < 31)
+                item[len++] = *text;
+            text++;
+        }
+        item[len] = '\0';
+        if (count < max)
+            strcpy(out[count], item);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * defineMacro – inicia definição a partir de '.MACRO nome p1, p2, ...'
+ *
+ * @return: true se sucesso, false se erro
+ */
+bool defineMacro(const char *header)
+{
+    char name[32];
+    if (sscanf(header, "%31s", name) != 1)
+    {
+        fprintf(stderr, "Erro: .MACRO sem nome\n");
+        return false;
+    }
+    if (findMacro(name))
+    {
+        fprintf(stderr, "Erro: macro %s redefinida\n", name);
+        return false;
+    }
+    if (macroTotal == macroCapacity)
+    {
+        int newCapacity = macroCapacity ? macroCapacity * 2 : 16;
+        Macro *grown = realloc(macroTable, newCapacity * sizeof(Macro));
+        if (!grown)
+            return false;
+        macroTable = grown;
+        macroCapacity = newCapacity;
+    }
+    Macro *macro = &macroTable[macroTotal++];
+    memset(macro, 0, sizeof(*macro));
+    strcpy(macro->name, name);
+    const char *rest = strstr(header, name) + strlen(name);
+    macro->paramCount = splitOperands(rest, macro->params, MAX_MACRO_PARAMS);
+    if (macro->paramCount > MAX_MACRO_PARAMS)
+    {
+        fprintf(stderr, "Erro: macro %s com mais de %d parametros\n", name, MAX_MACRO_PARAMS);
+        return false;
+    }
+    definingMacro = macro;
+    return true;
+}
+
+/**
+ * substituteMacroLine – troca parâmetros pelos argumentos e %%rotulo por rótulo único
+ * @line: linha do corpo da macro
+ * @macro: macro sendo expandida
+ * @args: argumentos da chamada
+ * @expansion: número único desta expansão
+ * @out: buffer de saída com LINE_SIZE bytes
+ */
+void substituteMacroLine(const char *line, const Macro *macro, char args[][32], int expansion, char *out)
+{
+    int len = 0;
+    while (*line && len < LINE_SIZE - 1)
+    {
+        if (isalpha((unsigned char)*line) || *line == '_' || (line[0] == '%' && line[1] == '%'))
+        {
+            char token[64];
+            int tokenLen = 0;
+            if (*line == '%')
+            {
+                line += 2;
+                tokenLen = snprintf(token, sizeof(token), "_M%d_", expansion);
+            }
+            while ((isalnum((unsigned char)*line) || *line == '_') && tokenLen < (int)sizeof(token) - 1)
+                token[tokenLen++] = *line++;
+            token[tokenLen] = '\0';
+
+            const char *replacement = token;
+            for (int i = 0; i < macro->paramCount; i++)
+            {
+                if (strcmp(token, macro->params[i]) == 0)
+                {
+                    replacement = args[i];
+                    break;
+                }
+            }
+            len += snprintf(out + len, LINE_SIZE - len, "%s", replacement);
+            if (len >= LINE_SIZE)
+                len = LINE_SIZE - 1;
+        }
+        else if (isdigit((unsigned char)*line))
+        {
+            while (isalnum((unsigned char)*line) && len < LINE_SIZE - 1)
+                out[len++] = *line++;
+        }
+        else
+        {
+            out[len++] = *line++;
+        }
+    }
+    out[len] = '\0';
+}
+
+bool preprocessLine(SourceLines *out, const char *rawLine, int depth);
+
+/**
+ * expandMacro – expande uma chamada de macro no buffer de saída
+ * @out: buffer de linhas
+ * @macro: macro chamada
+ * @argText: texto dos argumentos
+ * @depth: profundidade de expansão (macros podem chamar macros)
+ *
+ * @return: true se sucesso, false se erro
+ */
+bool expandMacro(SourceLines *out, Macro *macro, const char *argText, int depth)
+{
+    if (depth >= MAX_MACRO_DEPTH)
+    {
+        fprintf(stderr, "Erro: expansao de %s excede profundidade %d\n", macro->name, MAX_MACRO_DEPTH);
+        return false;
+    }
+    char args[MAX_MACRO_PARAMS][32];
+    int argCount = splitOperands(argText, args, MAX_MACRO_PARAMS);
+    if (argCount != macro->paramCount)
+    {
+        fprintf(stderr, "Erro: macro %s espera %d argumentos, recebeu %d\n", macro->name, macro->paramCount, argCount);
+        return false;
+    }
+
+    int expansion = macroExpansionCount++;
+    printf("Macro expandida: %s (#%d)\n", macro->name, expansion);
+    for (int i = 0; i < macro->body.count; i++)
+    {
+        char expanded[LINE_SIZE];
+        substituteMacroLine(macro->body.lines[i], macro, args, expansion, expanded);
+        if (!preprocessLine(out, expanded, depth + 1))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * preprocessLine – remove comentários, registra definições de macro e expande chamadas
+ * @out: buffer de linhas resultante
+ * @rawLine: linha original
+ * @depth: profundidade de expansão
+ *
+ * @return: true se sucesso, false se erro
+ */
+bool preprocessLine(SourceLines *out, const char *rawLine, int depth)
+{
+    char line[LINE_SIZE];
+    strncpy(line, rawLine, sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    removeCommentsAndTrim(line);
+    char *ptr = line;
+    while (isspace((unsigned char)*ptr))
+        ptr++;
+    if (*ptr == '\0')
+        return true;
+
+    if (definingMacro)
+    {
+        if (strncasecmp(ptr, ".ENDM", 5) == 0)
+        {
+            definingMacro = NULL;
+            return true;
+        }
+        return appendLine(&definingMacro->body, ptr);
+    }
+    if (strncasecmp(ptr, ".MACRO", 6) == 0 && isspace((unsigned char)ptr[6]))
+        return defineMacro(ptr + 6);
+
+    if (strncasecmp(ptr, ".DATA", 5) == 0)
+        preprocessInCode = false;
+    else if (strncasecmp(ptr, ".CODE", 5) == 0)
+        preprocessInCode = true;
+
+    /* em .DATA o primeiro token é o nome de um dado: uma variável shl ou mul8 não é macro */
+    char first[32] = {0};
+    sscanf(ptr, "%31s", first);
+    Macro *macro = preprocessInCode ? findMacro(first) : NULL;
+    if (!macro)
+        return appendLine(out, ptr);
+    return expandMacro(out, macro, ptr + strlen(first), depth);
+}
+
+/**
+ * loadSource – lê o arquivo .asm e produz as linhas já expandidas
+ * @source: arquivo aberto
+ * @out: buffer de linhas resultante
+ *
+ * @return: true se sucesso, false se erro
+ */
+bool loadSource(FILE *source, SourceLines *out)
+{
+    SourceLines unused = {0};
+    for (int i = 0; builtinMacroLibrary[i]; i++)
+    {
+        if (!preprocessLine(&unused, builtinMacroLibrary[i], 0))
+            return false;
+    }
+    freeSourceLines(&unused);
+
+    preprocessInCode = false;
+    char line[LINE_SIZE];
+    while (fgets(line, sizeof(line), source))
+    {
+        if (!preprocessLine(out, line, 0))
+            return false;
+    }
+    if (definingMacro)
+    {
+        fprintf(stderr, "Erro: macro %s sem .ENDM\n", definingMacro->name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * freeMacros – libera a tabela de macros
+ */
+void freeMacros()
+{
+    for (int i = 0; i < macroTotal; i++)
+        freeSourceLines(&macroTable[i].body);
+    free(macroTable);
+    macroTable = NULL;
+    macroTotal = macroCapacity = 0;
+}
+
 /**
  * assembleSource – processa o arquivo ASM e gera arquivo binário
  * @sourceFile: nome do arquivo .asm de entrada
@@ -144,14 +681,34 @@ bool assembleSource(const char *sourceFile, const char *binOutputFile)
         return false;
     }
 
-    uint8_t memory[MEMORY_SIZE] = {0};
+    /* pré-processamento: macros são expandidas antes das duas passagens */
+    SourceLines src = {0};
+    bool loaded = loadSource(source, &src);
+    fclose(source);
+    if (!loaded)
+    {
+        freeSourceLines(&src);
+        return false;
+    }
+
+    /* no modo estendido a memória cobre 64K palavras e os operandos têm 16 bits */
+    size_t memorySize = extendedMode ? WIDEMEMORYSIZE : MEMORY_SIZE;
+    uint8_t *memory = calloc(memorySize, 1);
+    if (!memory)
+    {
+        perror("Erro ao alocar memória");
+        freeSourceLines(&src);
+        return false;
+    }
     uint8_t header[HEADER_SIZE] = {0x03, 0x4E, 0x44, 0x52};
     memcpy(memory, header, HEADER_SIZE);
+    bool overflow = false;
 
     int dataPos = DATA_OFFSET;
     int originOffset = 0;
     int codeStart = HEADER_SIZE + originOffset * 2;
     int codePos = codeStart;
+    int codeLow = -1, codeHigh = codeStart;
 
     enum
     {
@@ -161,17 +718,12 @@ bool assembleSource(const char *sourceFile, const char *binOutputFile)
     } currentSection = NONE;
     registerSymbol("RES", RESULT_ADDR_OFFSET, 0, false);
 
-    char line[LINE_SIZE];
     /* primeira passagem: coleta de rótulos e dados */
     int tempCodePos = codeStart;
-    while (fgets(line, sizeof(line), source))
+    int codeEnd = codeStart;
+    for (int li = 0; li < src.count; li++)
     {
-        removeCommentsAndTrim(line);
-        char *ptr = line;
-        while (isspace((unsigned char)*ptr))
-            ptr++;
-        if (*ptr == '\0')
-            continue;
+        char *ptr = src.lines[li];
 
         char tag[32] = {0};
         if (strchr(ptr, ':'))
@@ -182,6 +734,7 @@ bool assembleSource(const char *sourceFile, const char *binOutputFile)
                 if (!isSymbolDefined(tag))
                 {
                     registerSymbol(tag, tempCodePos, 0, true);
+                    labelTable[labelTotal - 1].isCode = true;
                     printf("Simbolo encontrado: %s at %d\n", tag, tempCodePos);
                 }
                 continue;
@@ -220,6 +773,17 @@ bool assembleSource(const char *sourceFile, const char *binOutputFile)
                 {
                     registerSymbol(tag, dataPos, val, def);
                 }
+                else if (strcmp(tag, "RES") == 0 && labelTable[0].memoryAddr == RESULT_ADDR_OFFSET)
+                {
+                    /* RES declarado: usa a posição declarada em vez da padrão, que colide
+                     * com o terceiro dado do segmento */
+                    labelTable[0].memoryAddr = dataPos;
+                }
+                if ((size_t)dataPos + 2 > memorySize)
+                {
+                    overflow = true;
+                    continue;
+                }
                 memory[dataPos] = (uint8_t)val;
                 memory[dataPos + 1] = 0;
                 dataPos += 2;
@@ -243,22 +807,50 @@ bool assembleSource(const char *sourceFile, const char *binOutputFile)
             if (sscanf(ptr, "%15s %31s", instruction, operand) >= 1)
             {
                 tempCodePos += 4;
+                if (tempCodePos > codeEnd)
+                    codeEnd = tempCodePos;
+            }
+        }
+    }
+
+    /* código que invade a área de dados: erro no modo legado, realocação dos dados no estendido */
+    int dataStart = DATA_OFFSET;
+    if (codeEnd > DATA_OFFSET)
+    {
+        if (!extendedMode)
+        {
+            fprintf(stderr, "Erro: codigo ocupa %d palavras e invade a area de dados (limite %d); use --extended\n",
+                    (codeEnd - HEADER_SIZE) / 2, (DATA_OFFSET - HEADER_SIZE) / 2);
+            freeSourceLines(&src);
+            free(memory);
+            return false;
+        }
+        int delta = codeEnd - DATA_OFFSET;
+        if ((size_t)dataPos + delta > memorySize)
+        {
+            overflow = true;
+        }
+        else
+        {
+            memmove(memory + codeEnd, memory + DATA_OFFSET, dataPos - DATA_OFFSET);
+            memset(memory + DATA_OFFSET, 0, delta);
+            for (int i = 0; i < labelTotal; i++)
+            {
+                if (!labelTable[i].isCode)
+                    labelTable[i].memoryAddr += delta;
             }
+            dataPos += delta;
+            dataStart = codeEnd;
+            printf("Dados realocados para a palavra %d\n", (dataStart - HEADER_SIZE) / 2);
         }
     }
-    rewind(source);
 
     /* segunda passagem: geração de binário */
     currentSection = NONE;
     codePos = codeStart;
-    while (fgets(line, sizeof(line), source))
+    for (int li = 0; li < src.count; li++)
     {
-        removeCommentsAndTrim(line);
-        char *ptr = line;
-        while (isspace((unsigned char)*ptr))
-            ptr++;
-        if (*ptr == '\0')
-            continue;
+        char *ptr = src.lines[li];
         if (strchr(ptr, ':'))
             continue;
         if (strncasecmp(ptr, ".DATA", 5) == 0)
@@ -290,6 +882,7 @@ bool assembleSource(const char *sourceFile, const char *binOutputFile)
                 continue;
             uint8_t opcode = 0;
             uint8_t opByte = 0;
+            uint8_t opHigh = 0;
 
             /* mapeamento de instruções */
             if (strcasecmp(instruction, "LDA") == 0)
@@ -333,23 +926,31 @@ bool assembleSource(const char *sourceFile, const char *binOutputFile)
                     registerSymbol(operand, dataPos, 0, false);
                     addr = dataPos;
                     dataPos += 2;
+                    if ((size_t)dataPos > memorySize)
+                        overflow = true;
                 }
-                opByte = (uint8_t)((addr - HEADER_SIZE) / 2);
+                int operandWord = (addr - HEADER_SIZE) / 2;
+                opByte = (uint8_t)operandWord;
+                opHigh = extendedMode ? (uint8_t)(operandWord >> 8) : 0;
             }
 
             /* grava instrução na memória */
+            if (codeLow < 0 || codePos < codeLow)
+                codeLow = codePos;
             memory[codePos] = opcode;
             memory[codePos + 1] = 0;
             memory[codePos + 2] = opByte;
-            memory[codePos + 3] = 0;
+            memory[codePos + 3] = opHigh;
 
             printf("Instruções: %s %s - Opcode: 0x%02X Operand: 0x%02X (Addr: %d)\n",
                    instruction, count > 1 ? operand : "", opcode, opByte, codePos);
 
             codePos += 4;
+            if (codePos > codeHigh)
+                codeHigh = codePos;
         }
     }
-    fclose(source);
+    freeSourceLines(&src);
 
     /* avisos de símbolos não definidos */
     for (int i = 0; i < labelTotal; i++)
@@ -360,16 +961,61 @@ bool assembleSource(const char *sourceFile, const char *binOutputFile)
         }
     }
 
-    FILE *out = fopen(binOutputFile, "wb");
-    if (!out)
+    if (overflow)
     {
-        perror("Falha ao criar o arquivo binario");
+        fprintf(stderr, "Erro: dados excedem a memoria de %zu bytes%s\n", memorySize,
+                extendedMode ? "" : "; use --extended");
+        free(memory);
         return false;
     }
-    fwrite(memory, 1, MEMORY_SIZE, out);
-    fclose(out);
 
-    printf("\nAssembly criado: %s\n", binOutputFile);
+    bool written;
+    if (compactOutput || extendedMode)
+    {
+        if (codeLow < 0)
+            codeLow = codeHigh = codeStart;
+        ImageLayout layout = {0};
+        layout.compact = true;
+        layout.entry = (codeLow - HEADER_SIZE) / 2;
+        layout.codeBase = layout.entry;
+        layout.codeWords = (codeHigh - codeLow) / 2;
+        layout.dataBase = (dataStart - HEADER_SIZE) / 2;
+        layout.dataWords = (dataPos - dataStart) / 2;
+        layout.flags = extendedMode ? COMPACTFLAGWIDE : 0;
+
+        ImageSymbol *symbols = NULL;
+        if (emitSymbols && labelTotal > 0)
+        {
+            symbols = malloc(labelTotal * sizeof(ImageSymbol));
+            if (!symbols)
+            {
+                perror("Erro ao alocar memória");
+                free(memory);
+                return false;
+            }
+            for (int i = 0; i < labelTotal; i++)
+            {
+                strncpy(symbols[i].name, labelTable[i].labelName, SYMBOLNAMESIZE - 1);
+                symbols[i].name[SYMBOLNAMESIZE - 1] = '\0';
+                symbols[i].address = (uint16_t)((labelTable[i].memoryAddr - HEADER_SIZE) / 2);
+            }
+            layout.flags |= COMPACTFLAGSYMBOLS;
+            layout.symbols = symbols;
+            layout.symbolCount = (uint16_t)labelTotal;
+        }
+        written = write_compact_image(binOutputFile, memory, &layout);
+        free(symbols);
+    }
+    else
+    {
+        written = write_legacy_image(binOutputFile, memory);
+    }
+    free(memory);
+    if (!written)
+        return false;
+
+    printf("\nAssembly criado: %s%s\n", binOutputFile,
+           extendedMode ? " (formato compacto, modo estendido)" : compactOutput ? " (formato compacto)" : "");
     return true;
 }
 
@@ -378,16 +1024,32 @@ int main(int argc, char *argv[])
     char asmFile[256] = "programa.asm";
     char binFile[256] = "programa.bin";
 
-    if (argc > 1)
-        strncpy(asmFile, argv[1], sizeof(asmFile) - 1);
-    if (argc > 2)
-        strncpy(binFile, argv[2], sizeof(binFile) - 1);
+    /* opções: --compact grava formato NDC, --symbols inclui a tabela de símbolos,
+     * --extended usa operandos de 16 bits (implica formato compacto) */
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--compact") == 0)
+            compactOutput = true;
+        else if (strcmp(argv[i], "--symbols") == 0)
+            compactOutput = emitSymbols = true;
+        else if (strcmp(argv[i], "--extended") == 0)
+            compactOutput = extendedMode = true;
+        else if (positional++ == 0)
+            strncpy(asmFile, argv[i], sizeof(asmFile) - 1);
+        else
+            strncpy(binFile, argv[i], sizeof(binFile) - 1);
+    }
 
     printf("Assembling: %s -> %s\n\n", asmFile, binFile);
     if (!assembleSource(asmFile, binFile))
     {
         fprintf(stderr, "Assembly falhou.\n");
+        free(labelTable);
+        freeMacros();
         return 1;
     }
+    free(labelTable);
+    freeMacros();
     return 0;
 }
\ No newline at end of file
@@ -3,6 +3,131 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include "neander.h"
+
+bool verbose = true;
+bool divideBySubtraction = false; /* --div-subtract: gerador de divisão antigo */
+bool emitBinary = false;          /* --emit-bin: grava o .bin sem passar pelo montador */
+bool emitAssembly = true;         /* .asm; com --emit-bin, só se --emit-asm */
+bool batchMode = false;           /* vários arquivos: sem mensagens de sucesso por arquivo */
+bool wideIntegers = false;        /* --int16: inteiros de 16 bits, duas palavras por variável */
+
+/**
+ * EvalMode – uso do avaliador de bytecode (--eval, --eval-check)
+ */
+typedef enum
+{
+    EVAL_OFF,
+    EVAL_ONLY, /* --eval: só o bytecode, sem gerar código */
+    EVAL_CHECK /* --eval-check: compila e confere o código gerado com o bytecode */
+} EvalMode;
+
+EvalMode evalMode = EVAL_OFF;
+
+bool timeReport = false;     /* --time-report: tempo e memória por fase */
+bool timeReportJson = false; /* --time-report=json */
+bool lexBenchmark = false;   /* --lex-bench: só mede o lexer */
+
+const char *cacheDir = NULL; /* --cache DIR: reaproveita .asm/.bin de entradas já compiladas */
+atomic_int cacheHits;
+atomic_int cacheMisses;
+
+void failCompilation();
+
+/**
+ * ArenaBlock – bloco de memória de uma arena
+ */
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;
+    size_t used;
+    size_t size;
+    max_align_t data[];
+} ArenaBlock;
+
+/**
+ * Arena – alocador por incremento de ponteiro; tudo é liberado de uma vez
+ */
+typedef struct
+{
+    ArenaBlock *head;
+    size_t bytesUsed;
+    size_t blockCount;
+    size_t allocCount;
+} Arena;
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/**
+ * arenaAlloc – reserva memória alinhada na arena
+ * @arena: arena de destino
+ * @size: número de bytes
+ * @return: ponteiro para a região reservada (aborta se faltar memória)
+ */
+void *arenaAlloc(Arena *arena, size_t size)
+{
+    size_t align = sizeof(max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+    ArenaBlock *block = arena->head;
+    if (!block || block->used + size > block->size)
+    {
+        size_t capacity = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        block = malloc(sizeof(ArenaBlock) + capacity);
+        if (!block)
+        {
+            perror("Erro ao alocar memória");
+            failCompilation();
+        }
+        block->used = 0;
+        block->size = capacity;
+        block->next = arena->head;
+        arena->head = block;
+        arena->blockCount++;
+    }
+    void *ptr = (char *)block->data + block->used;
+    block->used += size;
+    arena->bytesUsed += size;
+    arena->allocCount++;
+    return ptr;
+}
+
+/**
+ * arenaStrndup – copia os len primeiros bytes de text para a arena
+ */
+char *arenaStrndup(Arena *arena, const char *text, size_t len)
+{
+    char *copy = arenaAlloc(arena, len + 1);
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/**
+ * arenaRelease – libera todos os blocos da arena
+ */
+void arenaRelease(Arena *arena)
+{
+    ArenaBlock *block = arena->head;
+    while (block)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->bytesUsed = 0;
+    arena->blockCount = 0;
+    arena->allocCount = 0;
+}
 
 /**
  * tokenType – lista de tipos de token para análise léxica
@@ -30,1051 +155,4330 @@ typedef enum
 /**
  * LexToken – representa um token com tipo e lexema
  * @type: tipo do token
- * @lexeme: conteúdo textual do token
+ * @lexeme: conteúdo textual do token; válido até o próximo getLexToken
+ * @capacity: tamanho do buffer de lexeme, que cresce sob demanda
  */
 typedef struct
 {
     tokenType type;
-    char lexeme[64];
+    char *lexeme;
+    size_t capacity;
 } LexToken;
 
-#define MAX_TOKENS 1024
-LexToken tokens[MAX_TOKENS];
-int tokenCount = 0;
-int currentToken = 0;
+#define LEX_BUFFER_SIZE (64 * 1024)
+#define LEX_MAX_LOOKAHEAD 16
 
-char *source;
-int sourcePos = 0;
+/**
+ * LexSource – leitura bufferizada do arquivo .lpn
+ * O buffer tem tamanho fixo, então a memória do lexer não depende do tamanho da entrada.
+ */
+typedef struct
+{
+    FILE *fp;
+    char buffer[LEX_BUFFER_SIZE];
+    size_t len;
+    size_t pos;
+    bool eof;
+} LexSource;
 
 /**
- * skipWhitespace – avança source_pos sobre espaços e tabs
- * Efeitos colaterais: modifica source_pos
+ * ExprNodeType – tipos de nó na AST de expressões
  */
-void skipWhitespace()
+typedef enum
 {
-    while (source[sourcePos] == ' ' || source[sourcePos] == '\t')
-        sourcePos++;
-}
+    EXPR_NUM,
+    EXPR_VAR,
+    EXPR_BINOP
+} ExprNodeType;
 
 /**
- * isLetter – verifica se caractere é letra ASCII
- * @c: caractere a verificar
- * @return: não-zero se letra, zero caso contrário
+ * ExprId – índice de um nó de expressão no ExprPool
  */
-int isLetter(char c)
+typedef uint32_t ExprId;
+
+/**
+ * ExprPool – nós de expressão em estrutura de arrays
+ *
+ * Um nó ocupa 11 bytes, um em cada coluna: os percursos só tocam as colunas
+ * que leem, e os filhos são índices de 32 bits em vez de ponteiros. Nas
+ * folhas, left guarda o literal (EXPR_NUM) ou o id do símbolo (EXPR_VAR).
+ */
+typedef struct
 {
-    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
-}
+    uint8_t *type; /* ExprNodeType */
+    uint8_t *op;   /* '+', '-', '*' ou '/' (EXPR_BINOP) */
+    int8_t *need;  /* número de Sethi–Ullman (registerNeed), -1 antes de calculado */
+    uint32_t *left;
+    uint32_t *right;
+    uint32_t count;
+    uint32_t capacity;
+} ExprPool;
 
 /**
- * isDigit – verifica se caractere é dígito ASCII
- * @c: caractere a verificar
- * @return: não-zero se dígito, zero caso contrário
+ * compilationUnit – representa programa compilado
  */
-int isDigit(char c)
+typedef struct
 {
-    return (c >= '0' && c <= '9');
-}
+    char *name;
+    ExprId resultExpr;
+} compilationUnit;
 
 /**
- * addToken – adiciona token ao vetor tokens
- * @type: tipo do token
- * @lexeme: string do lexema
- * Efeitos colaterais: incrementa token_count
+ * IrOperandKind – origem de um operando do IR
  */
-void addToken(tokenType type, const char *lexeme)
+typedef enum
 {
-    if (tokenCount < MAX_TOKENS)
-    {
-        tokens[tokenCount].type = type;
-        strncpy(tokens[tokenCount].lexeme, lexeme, sizeof(tokens[tokenCount].lexeme) - 1);
-        tokens[tokenCount].lexeme[sizeof(tokens[tokenCount].lexeme) - 1] = '\0';
-        tokenCount++;
-    }
-}
+    OPND_NONE,
+    OPND_CONST, /* literal de 8 bits */
+    OPND_VAR,   /* variável do programa (memória) */
+    OPND_TEMP   /* temporário SSA: definido uma única vez */
+} IrOperandKind;
 
 /**
- * tokenizeInput – realiza análise léxica de source_code
- * Efeitos colaterais: preenche tokens e imprime debug
+ * IrOperand – operando de uma instrução de três endereços
  */
-void tokenizeInput()
+typedef struct
 {
-    tokenCount = 0;
-    currentToken = 0;
-    sourcePos = 0;
-    while (source[sourcePos] != '\0')
-    {
-        if (source[sourcePos] == ' ' || source[sourcePos] == '\t')
-        {
-            skipWhitespace();
-            continue;
-        }
-        if (source[sourcePos] == '\n' || source[sourcePos] == '\r')
-        {
-            sourcePos++;
-            continue;
-        }
-        if (strncmp(&source[sourcePos], "PROGRAMA", 8) == 0 && !isLetter(source[sourcePos + 8]))
-        {
-            addToken(TOKEN_PROGRAM, "PROGRAMA");
-            sourcePos += 8;
-            continue;
-        }
-        if (strncmp(&source[sourcePos], "INICIO", 6) == 0 && !isLetter(source[sourcePos + 6]))
-        {
-            addToken(TOKEN_BEGIN, "INICIO");
-            sourcePos += 6;
-            continue;
-        }
-        if (strncmp(&source[sourcePos], "FIM", 3) == 0 && !isLetter(source[sourcePos + 3]))
-        {
-            addToken(TOKEN_END, "FIM");
-            sourcePos += 3;
-            continue;
-        }
-        if (strncmp(&source[sourcePos], "RES", 3) == 0 && !isLetter(source[sourcePos + 3]))
-        {
-            addToken(TOKEN_RES, "RES");
-            sourcePos += 3;
-            continue;
-        }
-        if (source[sourcePos] == '=')
-        {
-            addToken(TOKEN_EQ, "=");
-            sourcePos++;
-            continue;
-        }
-        if (source[sourcePos] == '+')
-        {
-            addToken(TOKEN_PLUS, "+");
-            sourcePos++;
-            continue;
-        }
-        if (source[sourcePos] == '-')
-        {
-            addToken(TOKEN_MINUS, "-");
-            sourcePos++;
-            continue;
-        }
-        if (source[sourcePos] == '*')
-        {
-            addToken(TOKEN_TIMES, "*");
-            sourcePos++;
-            continue;
-        }
-        if (source[sourcePos] == '/')
-        {
-            addToken(TOKEN_DIVIDE, "/");
-            sourcePos++;
-            continue;
-        }
-        if (source[sourcePos] == '(')
-        {
-            addToken(TOKEN_LPAREN, "(");
-            sourcePos++;
-            continue;
-        }
-        if (source[sourcePos] == ')')
-        {
-            addToken(TOKEN_RPAREN, ")");
-            sourcePos++;
-            continue;
-        }
-        if (source[sourcePos] == ':')
-        {
-            addToken(TOKEN_COLON, ":");
-            sourcePos++;
-            continue;
-        }
-        if (source[sourcePos] == '\"')
-        {
-            sourcePos++;
-            int start = sourcePos;
-            while (source[sourcePos] != '\"' && source[sourcePos] != '\0')
-                sourcePos++;
-            int len = sourcePos - start;
-            char ident[64];
-            strncpy(ident, &source[start], len);
-            ident[len] = '\0';
-            addToken(TOKEN_IDENT, ident);
-            if (source[sourcePos] == '\"')
-                sourcePos++;
-            continue;
-        }
-        if (isLetter(source[sourcePos]))
-        {
-            int start = sourcePos;
-            while (isLetter(source[sourcePos]) || isDigit(source[sourcePos]) || source[sourcePos] == '_')
-                sourcePos++;
-            int len = sourcePos - start;
-            char ident[64];
-            strncpy(ident, &source[start], len);
-            ident[len] = '\0';
-            addToken(TOKEN_IDENT, ident);
-            continue;
-        }
-        if (isDigit(source[sourcePos]))
-        {
-            int start = sourcePos;
-            while (isDigit(source[sourcePos]))
-                sourcePos++;
-            int len = sourcePos - start;
-            char num[64];
-            strncpy(num, &source[start], len);
-            num[len] = '\0';
-            addToken(TOKEN_NUM, num);
-            continue;
-        }
-        sourcePos++;
-    }
-    addToken(TOKEN_EOF, "EOF");
+    IrOperandKind kind;
+    int value; /* valor (OPND_CONST), símbolo da variável (OPND_VAR) ou número do temporário (OPND_TEMP) */
+} IrOperand;
 
-    printf("LexTokens Gerados (%d tokens)\n\n", tokenCount);
-    for (int i = 0; i < tokenCount; i++)
-    {
-        printf("[%d] %d - '%s'\n", i, tokens[i].type, tokens[i].lexeme);
-    }
-    printf("\n", tokenCount);
-}
+/**
+ * IrOpcode – instruções do IR
+ */
+typedef enum
+{
+    IR_NOP,
+    IR_STMT,   /* marca o início de uma atribuição (var = id da variável) ou do resultado (var = -1) */
+    IR_COPY,   /* dst = a */
+    IR_ADD,    /* dst = a + b */
+    IR_SUB,    /* dst = a - b */
+    IR_MUL,    /* dst = a * b */
+    IR_DIV,    /* dst = a / b */
+    IR_STORE,  /* var = a */
+    IR_RESULT  /* RES = a; fim do programa */
+} IrOpcode;
 
 /**
- * peekLexToken – retorna o token atual sem consumi-lo
- * @return: ponteiro para token_t ou NULL
+ * IrInstr – instrução de três endereços
  */
-LexToken *peekLexToken()
+typedef struct
 {
-    if (currentToken < tokenCount)
-        return &tokens[currentToken];
-    return NULL;
-}
+    IrOpcode op;
+    int dst; /* temporário definido, -1 se nenhum */
+    IrOperand a, b;
+    int var; /* símbolo atribuído (IR_STMT, IR_STORE), -1 se nenhum */
+} IrInstr;
 
 /**
- * getLexToken – consome e retorna o token atual
- * @return: ponteiro para token_t ou NULL
+ * IrProgram – programa linear em IR
  */
-LexToken *getLexToken()
+typedef struct
 {
-    if (currentToken < tokenCount)
-        return &tokens[currentToken++];
-    return NULL;
-}
+    IrInstr *code;
+    int count;
+    int capacity;
+    int tempCount;
+} IrProgram;
 
 /**
- * ExprNodeType – tipos de nó na AST de expressões
+ * Var – representa entry na tabela de variáveis/constantes
  */
-typedef enum
+typedef struct
 {
-    EXPR_NUM,
-    EXPR_VAR,
-    EXPR_BINOP
-} ExprNodeType;
+    char *name;
+    uint32_t hash;
+    int value;
+    bool defined;
+    bool reserved; /* RES e TEMP_<n>: declarados à parte no .DATA */
+    bool declared; /* já referenciado pelo código gerado */
+    int high;      /* --int16: id de <nome>.HI, a palavra alta; -1 se ainda não criado */
+} Var;
+
+/* operandos cujo valor o acumulador contém agora (STA não altera o AC) */
+#define MAX_AC_ALIASES 4
 
 /**
- * ExprNode – nó de expressão (num, var ou binop)
+ * PhaseReport – tempo e memória de uma fase da compilação (--time-report)
  */
-typedef struct ExprNode
+typedef struct
 {
-    ExprNodeType type;
-    union
-    {
-        int num;
-        char var[64];
-        struct
-        {
-            char op;
-            struct ExprNode *left;
-            struct ExprNode *right;
-        } binop;
-    };
-} ExprNode;
+    const char *name;
+    double seconds;
+    double debugSeconds; /* parte do tempo gasta em debugLog */
+    size_t allocations;  /* alocações na arena */
+    size_t arenaBytes;
+    long heapBytes; /* variação do heap em uso (malloc) */
+    long peakRssKb; /* pico de memória do processo ao fim da fase */
+} PhaseReport;
+
+#define MAX_PHASES 16
 
 /**
- * createNumExpr – cria nó de número literal
+ * Compilation – estado de uma compilação
+ *
+ * Tudo o que o lexer, o parser, os passes e o gerador de código modificam
+ * fica aqui, e não em variáveis globais, para que várias compilações rodem
+ * ao mesmo tempo em threads diferentes (modo em lote). Cada thread aponta cc
+ * para a compilação corrente; as opções da linha de comando continuam
+ * globais, pois são só lidas.
  */
-ExprNode *createNumExpr(int value)
+typedef struct
 {
-    ExprNode *node = malloc(sizeof(ExprNode));
-    node->type = EXPR_NUM;
-    node->num = value;
-    return node;
+    /* nós da AST, atribuições, lexemas e nomes de símbolos vivem nesta arena */
+    Arena astArena;
+    jmp_buf failure; /* destino de failCompilation */
+    const char *inputFile; /* programa .lpn, para identificar os avisos no lote */
+    FILE *input;
+    FILE *asmFile;
+
+    /* lexer */
+    LexSource lexSource;
+    LexToken currentLexToken; /* último token consumido */
+    LexToken lookaheadToken;  /* próximo token, já analisado por peekLexToken */
+    bool hasLookahead;
+    bool lexerFinished; /* TOKEN_EOF já foi consumido */
+    int tokenCount;
+    bool hashingTokens; /* passada de hashTokenStream: sem saída de depuração */
+
+    /* parser */
+    ExprPool exprs;
+    struct codeLine *statements;
+    struct codeLine *lastStmt;
+    compilationUnit program;
+
+    /* IR e passes */
+    IrProgram ir;
+    struct ConstBinding *bindings; /* indexados pelo símbolo */
+    IrOperand *tempSubst; /* substituição de temporários: operando equivalente, OPND_NONE se nenhum */
+    bool *liveVars;
+    int *versions;
+    struct ValueRange *tempRanges; /* intervalo de cada temporário do IR */
+    struct ValueRange *varRanges;  /* intervalo do valor corrente de cada variável */
+    int rangeVarCount;
+
+    /* tabela de símbolos: o id de um símbolo é o seu índice em varTable */
+    Var *varTable;
+    int varCount;
+    int varCapacity;
+    int *symbolIndex;     /* hash com endereçamento aberto: id + 1, 0 se livre */
+    int symbolIndexSize;  /* potência de 2 */
+    int constSymbol[256]; /* id + 1 de CONST_<n>, 0 se ainda não existe */
+    int *dataSymbols;     /* ids declarados no .DATA, na ordem do primeiro uso */
+    int dataSymbolCount;
+
+    /* geração de código */
+    int tempCount;
+    FILE *asmOut;
+    int labelCounter;
+    IrOperand acAliases[MAX_AC_ALIASES]; /* operandos cujo valor o acumulador contém agora */
+    int acAliasCount;
+    int *irTempHome; /* TEMP_ virtual que guarda cada temporário do IR, -1 se fica só no AC */
+    int *irTempUses; /* número de leituras de cada temporário do IR */
+    bool *tempInAcOnly;
+    struct TempInterval *tempIntervals;
+    int tempSlotCount;
+    char *codeText;
+    size_t codeSize;
+
+    /* --time-report */
+    PhaseReport phases[MAX_PHASES];
+    int phaseCount;
+    double lexSeconds;
+    double debugSeconds;
+    int stmtCount;
+} Compilation;
+
+_Thread_local Compilation *cc = NULL;
+
+/**
+ * nowSeconds – relógio monotônico, em segundos
+ */
+double nowSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
 }
 
 /**
- * createVarExpr – cria nó de variável
+ * debugLog – imprime mensagem de depuração quando a saída detalhada está ativa
+ *
+ * Com --time-report, o tempo gasto aqui é somado à parte, para mostrar o
+ * custo da própria saída de depuração.
  */
-ExprNode *createVarExpr(const char *name)
+void debugLog(const char *format, ...)
 {
-    ExprNode *node = malloc(sizeof(ExprNode));
-    node->type = EXPR_VAR;
-    strncpy(node->var, name, sizeof(node->var) - 1);
-    node->var[sizeof(node->var) - 1] = '\0';
-    return node;
+    if (!verbose)
+        return;
+    double start = timeReport ? nowSeconds() : 0;
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    if (timeReport && cc)
+        cc->debugSeconds += nowSeconds() - start;
 }
 
 /**
- * createBinOpExpr – cria nó binário (+, -, *, /)
+ * beginPhase – abre uma fase do --time-report
  */
-ExprNode *createBinOpExpr(char op, ExprNode *left, ExprNode *right)
+void beginPhase(const char *name)
 {
-    ExprNode *node = malloc(sizeof(ExprNode));
-    node->type = EXPR_BINOP;
-    node->binop.op = op;
-    node->binop.left = left;
-    node->binop.right = right;
-    return node;
+    if (!timeReport || cc->phaseCount == MAX_PHASES)
+        return;
+    PhaseReport *phase = &cc->phases[cc->phaseCount];
+    phase->name = name;
+    phase->seconds = nowSeconds();
+    phase->debugSeconds = cc->debugSeconds;
+    phase->allocations = cc->astArena.allocCount;
+    phase->arenaBytes = cc->astArena.bytesUsed;
+    phase->heapBytes = (long)mallinfo2().uordblks;
 }
 
-ExprNode *parseExpr();
-ExprNode *parseTermExpr();
-ExprNode *parseFactorExpr();
+/**
+ * endPhase – fecha a fase aberta por beginPhase, guardando as diferenças
+ */
+void endPhase()
+{
+    if (!timeReport || cc->phaseCount == MAX_PHASES)
+        return;
+    PhaseReport *phase = &cc->phases[cc->phaseCount++];
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    phase->seconds = nowSeconds() - phase->seconds;
+    phase->debugSeconds = cc->debugSeconds - phase->debugSeconds;
+    phase->allocations = cc->astArena.allocCount - phase->allocations;
+    phase->arenaBytes = cc->astArena.bytesUsed - phase->arenaBytes;
+    phase->heapBytes = (long)mallinfo2().uordblks - phase->heapBytes;
+    phase->peakRssKb = usage.ru_maxrss;
+}
 
 /**
- * parseExpr – analisa expressões com + e -
+ * openLexer – prepara o lexer para ler de fp
+ * @fp: arquivo .lpn aberto
  */
-ExprNode *parseExpr()
+void openLexer(FILE *fp)
 {
-    ExprNode *node = parseTermExpr();
-    LexToken *t;
-    while ((t = peekLexToken()) && (t->type == TOKEN_PLUS || t->type == TOKEN_MINUS))
-    {
-        t = getLexToken();
-        ExprNode *right = parseTermExpr();
-        node = createBinOpExpr(t->lexeme[0], node, right);
-    }
-    return node;
+    cc->lexSource.fp = fp;
+    cc->lexSource.len = 0;
+    cc->lexSource.pos = 0;
+    cc->lexSource.eof = false;
+    cc->hasLookahead = false;
+    cc->lexerFinished = false;
+    cc->tokenCount = 0;
 }
 
 /**
- * parseTermExpr – analisa expressões com * e /
+ * closeLexer – libera os buffers de lexema
  */
-ExprNode *parseTermExpr()
+void closeLexer()
 {
-    ExprNode *node = parseFactorExpr();
-    LexToken *t;
-    while ((t = peekLexToken()) && (t->type == TOKEN_TIMES || t->type == TOKEN_DIVIDE))
-    {
-        t = getLexToken();
-        ExprNode *right = parseFactorExpr();
-        node = createBinOpExpr(t->lexeme[0], node, right);
-    }
-    return node;
+    free(cc->currentLexToken.lexeme);
+    free(cc->lookaheadToken.lexeme);
+    memset(&cc->currentLexToken, 0, sizeof(cc->currentLexToken));
+    memset(&cc->lookaheadToken, 0, sizeof(cc->lookaheadToken));
 }
 
 /**
- * parseFactorExpr – números, identificadores e parênteses
+ * peekChar – retorna o caractere offset posições à frente, ou '\0' no fim
+ * Efeitos colaterais: recarrega o buffer quando necessário
  */
-ExprNode *parseFactorExpr()
+char peekChar(int offset)
 {
-    LexToken *t = peekLexToken();
-    if (!t)
-        return NULL;
-    if (t->type == TOKEN_LPAREN)
+    if (cc->lexSource.pos + offset >= cc->lexSource.len && !cc->lexSource.eof)
     {
-        getLexToken();
-        ExprNode *node = parseExpr();
-        getLexToken();
-        return node;
-    }
-    if (t->type == TOKEN_NUM)
-    {
-        t = getLexToken();
-        return createNumExpr(atoi(t->lexeme));
-    }
-    if (t->type == TOKEN_IDENT)
-    {
-        t = getLexToken();
-        return createVarExpr(t->lexeme);
+        size_t remaining = cc->lexSource.len - cc->lexSource.pos;
+        memmove(cc->lexSource.buffer, cc->lexSource.buffer + cc->lexSource.pos, remaining);
+        cc->lexSource.len = remaining;
+        cc->lexSource.pos = 0;
+        while (cc->lexSource.len < LEX_BUFFER_SIZE && !cc->lexSource.eof)
+        {
+            size_t n = fread(cc->lexSource.buffer + cc->lexSource.len, 1, LEX_BUFFER_SIZE - cc->lexSource.len, cc->lexSource.fp);
+            if (n == 0)
+                cc->lexSource.eof = true;
+            cc->lexSource.len += n;
+        }
     }
-    return NULL;
+    if (cc->lexSource.pos + offset >= cc->lexSource.len)
+        return '\0';
+    return cc->lexSource.buffer[cc->lexSource.pos + offset];
 }
 
 /**
- * codeLine – representa linha de atribuição
+ * advanceChar – consome count caracteres
  */
-typedef struct codeLine
+void advanceChar(int count)
 {
-    char var[64];
-    ExprNode *expr;
-    struct codeLine *next;
-} codeLine;
-
-codeLine *statements = NULL;
-codeLine *lastStmt = NULL;
+    cc->lexSource.pos += count;
+}
 
 /**
- * parseAssignment – analisa 'IDENT = expression'
+ * CharClass – classe de um byte da entrada; o lexer escolhe o token pelo
+ * primeiro byte e estende identificadores e números pela mesma tabela
  */
-void parseAssignment()
+typedef enum
 {
-    LexToken *t = getLexToken();
-    if (!t || t->type != TOKEN_IDENT)
-    {
-        printf("Aviso: erro na atribuição, token esperado é IDENT\n");
-        return;
-    }
-    char varName[64];
-    strncpy(varName, t->lexeme, sizeof(varName));
-    LexToken *eq = getLexToken();
-    if (!eq || eq->type != TOKEN_EQ)
-    {
-        printf("Aviso: erro na atribuição, token esperado é '='\n");
-        return;
-    }
-    ExprNode *expr = parseExpr();
+    CHAR_OTHER, /* ignorado */
+    CHAR_END,   /* '\0': fim da entrada */
+    CHAR_SPACE,
+    CHAR_QUOTE,
+    CHAR_PUNCT,
+    CHAR_LETTER, /* LETTER, DIGIT e UNDERSCORE continuam um identificador */
+    CHAR_DIGIT,
+    CHAR_UNDERSCORE
+} CharClass;
 
-    codeLine *stmt = malloc(sizeof(codeLine));
-    strncpy(stmt->var, varName, sizeof(stmt->var));
-    stmt->expr = expr;
-    stmt->next = NULL;
-    if (statements == NULL)
-    {
-        statements = stmt;
-        lastStmt = stmt;
-    }
-    else
-    {
-        lastStmt->next = stmt;
-        lastStmt = stmt;
-    }
+static const uint8_t charClass[256] = {
+    ['\0'] = CHAR_END,
+    [' '] = CHAR_SPACE,
+    ['\t'] = CHAR_SPACE,
+    ['\n'] = CHAR_SPACE,
+    ['\r'] = CHAR_SPACE,
+    ['"'] = CHAR_QUOTE,
+    ['='] = CHAR_PUNCT,
+    ['+'] = CHAR_PUNCT,
+    ['-'] = CHAR_PUNCT,
+    ['*'] = CHAR_PUNCT,
+    ['/'] = CHAR_PUNCT,
+    ['('] = CHAR_PUNCT,
+    [')'] = CHAR_PUNCT,
+    [':'] = CHAR_PUNCT,
+    ['A' ... 'Z'] = CHAR_LETTER,
+    ['a' ... 'z'] = CHAR_LETTER,
+    ['0' ... '9'] = CHAR_DIGIT,
+    ['_'] = CHAR_UNDERSCORE,
+};
 
-    printf("Depuração: Atribuição lida -> %s = (expressão)\n", varName);
-}
+static const uint8_t punctToken[256] = {
+    ['='] = TOKEN_EQ,     ['+'] = TOKEN_PLUS,   ['-'] = TOKEN_MINUS,  ['*'] = TOKEN_TIMES,
+    ['/'] = TOKEN_DIVIDE, ['('] = TOKEN_LPAREN, [')'] = TOKEN_RPAREN, [':'] = TOKEN_COLON,
+};
 
 /**
- * compilationUnit – representa programa compilado
+ * keywordTable – hash perfeito das palavras-chave: posição (primeira letra + tamanho) & 7
+ * PROGRAMA cai em 0, FIM em 1, RES em 5 e INICIO em 7; as demais posições ficam vazias.
  */
-typedef struct
+static const struct
 {
-    char name[64];
-    codeLine *stmts;
-    ExprNode *resultExpr;
-} compilationUnit;
-
-compilationUnit program;
+    const char *text;
+    size_t len;
+    tokenType type;
+} keywordTable[8] = {
+    [0] = {"PROGRAMA", 8, TOKEN_PROGRAM},
+    [1] = {"FIM", 3, TOKEN_END},
+    [5] = {"RES", 3, TOKEN_RES},
+    [7] = {"INICIO", 6, TOKEN_BEGIN},
+};
 
 /**
- * freeAST – libera memória da AST
+ * appendLexemeRun – acrescenta count caracteres ao lexema do token
  */
-void freeAST(ExprNode *node)
+void appendLexemeRun(LexToken *token, size_t *len, const char *text, size_t count)
 {
-    if (!node)
-        return;
-    if (node->type == EXPR_BINOP)
+    if (*len + count + 1 > token->capacity)
     {
-        freeAST(node->binop.left);
-        freeAST(node->binop.right);
+        size_t newCapacity = token->capacity ? token->capacity * 2 : 64;
+        while (newCapacity < *len + count + 1)
+            newCapacity *= 2;
+        char *grown = realloc(token->lexeme, newCapacity);
+        if (!grown)
+        {
+            perror("Erro ao alocar memória");
+            failCompilation();
+        }
+        token->lexeme = grown;
+        token->capacity = newCapacity;
     }
-    free(node);
+    memcpy(token->lexeme + *len, text, count);
+    *len += count;
+    token->lexeme[*len] = '\0';
 }
 
 /**
- * freeCodeLines – libera lista de codeLine
+ * appendLexeme – acrescenta caractere ao lexema do token
  */
-void freeCodeLines(codeLine *stmt)
+void appendLexeme(LexToken *token, size_t *len, char c)
 {
-    while (stmt)
-    {
-        codeLine *next = stmt->next;
-        freeAST(stmt->expr);
-        free(stmt);
-        stmt = next;
-    }
+    appendLexemeRun(token, len, &c, 1);
 }
 
 /**
- * parseCompilationUnit – analisa 'PROGRAMA name : INICIO ... RES = expr FIM'
+ * startToken – define o tipo do token e esvazia o lexema
+ * O buffer tem ao menos 64 bytes, então lexemas de um caractere cabem sem checagem.
  */
-void parseCompilationUnit()
+void startToken(LexToken *token, tokenType type)
 {
-    LexToken *t = getLexToken();
-    if (!t || t->type != TOKEN_PROGRAM)
+    token->type = type;
+    if (!token->lexeme)
     {
-        printf("Erro: esperado PROGRAMA\n");
-        exit(1);
+        token->lexeme = malloc(64);
+        if (!token->lexeme)
+        {
+            perror("Erro ao alocar memória");
+            failCompilation();
+        }
+        token->capacity = 64;
     }
+    token->lexeme[0] = '\0';
+}
 
-    t = getLexToken();
-    if (!t || t->type != TOKEN_IDENT)
+/**
+ * setToken – define tipo e lexema fixo do token
+ */
+void setToken(LexToken *token, tokenType type, const char *lexeme)
+{
+    size_t len = 0;
+    startToken(token, type);
+    appendLexemeRun(token, &len, lexeme, strlen(lexeme));
+}
+
+/**
+ * scanRun – consome os bytes de classe entre first e last e os acrescenta ao lexema
+ * Varre o buffer diretamente e copia cada trecho de uma vez; só volta a
+ * peekChar quando a sequência chega ao fim do buffer e é preciso recarregá-lo.
+ */
+void scanRun(LexToken *token, size_t *len, CharClass first, CharClass last)
+{
+    LexSource *source = &cc->lexSource;
+    for (;;)
+    {
+        size_t end = source->pos;
+        while (end < source->len && charClass[(uint8_t)source->buffer[end]] >= first &&
+               charClass[(uint8_t)source->buffer[end]] <= last)
+            end++;
+        appendLexemeRun(token, len, source->buffer + source->pos, end - source->pos);
+        source->pos = end;
+        if (end < source->len || peekChar(0) == '\0')
+            return;
+    }
+}
+
+/**
+ * scanLexToken – analisa o próximo token da entrada
+ * @token: token de destino (reaproveita o buffer de lexema)
+ * Efeitos colaterais: consome caracteres da entrada e imprime debug
+ *
+ * Cada byte é classificado uma vez por charClass. Palavras-chave são lidas
+ * como identificadores e reconhecidas depois, por keywordTable; assim RES1
+ * e FIM_X são identificadores, não a palavra-chave seguida de outro token.
+ */
+void scanLexToken(LexToken *token)
+{
+    LexSource *source = &cc->lexSource;
+    for (;;)
+    {
+        char c = peekChar(0);
+        size_t len = 0;
+        switch (charClass[(uint8_t)c])
+        {
+        case CHAR_END:
+            setToken(token, TOKEN_EOF, "EOF");
+            break;
+        case CHAR_SPACE:
+            while (source->pos < source->len && charClass[(uint8_t)source->buffer[source->pos]] == CHAR_SPACE)
+                source->pos++;
+            continue;
+        case CHAR_PUNCT:
+            startToken(token, (tokenType)punctToken[(uint8_t)c]);
+            token->lexeme[0] = c;
+            token->lexeme[1] = '\0';
+            advanceChar(1);
+            break;
+        case CHAR_QUOTE:
+            advanceChar(1);
+            startToken(token, TOKEN_IDENT);
+            while (peekChar(0) != '\"' && peekChar(0) != '\0')
+            {
+                appendLexeme(token, &len, peekChar(0));
+                advanceChar(1);
+            }
+            if (peekChar(0) == '\"')
+                advanceChar(1);
+            break;
+        case CHAR_LETTER:
+        {
+            startToken(token, TOKEN_IDENT);
+            scanRun(token, &len, CHAR_LETTER, CHAR_UNDERSCORE);
+            const char *text = token->lexeme;
+            int slot = ((uint8_t)text[0] + (int)len) & 7;
+            if (keywordTable[slot].len == len && memcmp(keywordTable[slot].text, text, len) == 0)
+                token->type = keywordTable[slot].type;
+            break;
+        }
+        case CHAR_DIGIT:
+            startToken(token, TOKEN_NUM);
+            scanRun(token, &len, CHAR_DIGIT, CHAR_DIGIT);
+            break;
+        default:
+            advanceChar(1);
+            continue;
+        }
+        break;
+    }
+
+    if (verbose && !cc->hashingTokens)
+        debugLog("[%d] %d - '%s'\n", cc->tokenCount, token->type, token->lexeme);
+    cc->tokenCount++;
+}
+
+/**
+ * peekLexToken – retorna o próximo token sem consumi-lo (um token de lookahead)
+ * @return: ponteiro para o token ou NULL após o fim da entrada
+ */
+LexToken *peekLexToken()
+{
+    if (cc->lexerFinished)
+        return NULL;
+    if (!cc->hasLookahead)
+    {
+        if (timeReport)
+        {
+            double start = nowSeconds(), debugBefore = cc->debugSeconds;
+            scanLexToken(&cc->lookaheadToken);
+            cc->lexSeconds += nowSeconds() - start - (cc->debugSeconds - debugBefore);
+        }
+        else
+        {
+            scanLexToken(&cc->lookaheadToken);
+        }
+        cc->hasLookahead = true;
+    }
+    return &cc->lookaheadToken;
+}
+
+/**
+ * getLexToken – consome e retorna o próximo token
+ * @return: ponteiro para o token, válido até a próxima chamada, ou NULL após o fim
+ */
+LexToken *getLexToken()
+{
+    if (!peekLexToken())
+        return NULL;
+    /* troca os buffers para não copiar o lexema */
+    LexToken consumed = cc->lookaheadToken;
+    cc->lookaheadToken = cc->currentLexToken;
+    cc->currentLexToken = consumed;
+    cc->hasLookahead = false;
+    if (cc->currentLexToken.type == TOKEN_EOF)
+        cc->lexerFinished = true;
+    return &cc->currentLexToken;
+}
+
+/**
+ * fnvHash – acumula bytes num hash FNV-1a de 64 bits
+ */
+uint64_t fnvHash(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+/**
+ * symbolSlot – posição de name no índice: a do símbolo, ou a livre onde ele entraria
+ */
+size_t symbolSlot(const char *name, size_t len, uint32_t hash)
+{
+    size_t mask = cc->symbolIndexSize - 1;
+    size_t slot = hash & mask;
+    while (cc->symbolIndex[slot])
+    {
+        Var *var = &cc->varTable[cc->symbolIndex[slot] - 1];
+        if (var->hash == hash && strncmp(var->name, name, len) == 0 && var->name[len] == '\0')
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * growSymbolTable – dobra a tabela de símbolos e refaz o índice
+ */
+void growSymbolTable()
+{
+    cc->varCapacity = cc->varCapacity ? cc->varCapacity * 2 : 64;
+    cc->varTable = realloc(cc->varTable, cc->varCapacity * sizeof(Var));
+    cc->dataSymbols = realloc(cc->dataSymbols, cc->varCapacity * sizeof(int));
+    cc->symbolIndexSize = 2 * cc->varCapacity;
+    free(cc->symbolIndex);
+    cc->symbolIndex = calloc(cc->symbolIndexSize, sizeof(int));
+    if (!cc->varTable || !cc->dataSymbols || !cc->symbolIndex)
+    {
+        perror("Erro ao alocar memória");
+        failCompilation();
+    }
+    size_t mask = cc->symbolIndexSize - 1;
+    for (int id = 0; id < cc->varCount; id++)
+    {
+        size_t slot = cc->varTable[id].hash & mask;
+        while (cc->symbolIndex[slot])
+            slot = (slot + 1) & mask;
+        cc->symbolIndex[slot] = id + 1;
+    }
+}
+
+/**
+ * findSymbol – id do símbolo com o nome dado
+ * @return: id, ou -1 se o nome nunca foi visto
+ */
+int findSymbol(const char *name, size_t len)
+{
+    if (cc->varCount == 0)
+        return -1;
+    return cc->symbolIndex[symbolSlot(name, len, (uint32_t)fnvHash(14695981039346656037ull, name, len))] - 1;
+}
+
+/**
+ * internSymbol – id do símbolo com o nome dado, criando-o no primeiro uso
+ *
+ * Os passes e o seletor comparam e indexam símbolos pelo id; o nome só é
+ * consultado ao escrever o assembly.
+ */
+int internSymbol(const char *name, size_t len)
+{
+    if (cc->varCount == cc->varCapacity)
+        growSymbolTable();
+    uint32_t hash = (uint32_t)fnvHash(14695981039346656037ull, name, len);
+    size_t slot = symbolSlot(name, len, hash);
+    if (cc->symbolIndex[slot])
+        return cc->symbolIndex[slot] - 1;
+
+    Var *var = &cc->varTable[cc->varCount];
+    var->name = arenaStrndup(&cc->astArena, name, len);
+    var->hash = hash;
+    var->value = 0;
+    var->defined = false;
+    var->reserved = strcmp(var->name, "RES") == 0 || strcmp(var->name, "RES.HI") == 0 ||
+                    strncmp(var->name, "TEMP_", 5) == 0;
+    var->declared = false;
+    var->high = -1;
+    cc->symbolIndex[slot] = cc->varCount + 1;
+    return cc->varCount++;
+}
+
+/**
+ * newExprNode – acrescenta um nó ao pool
+ * @return: índice do nó
+ */
+ExprId newExprNode(ExprNodeType type, uint8_t op, uint32_t left, uint32_t right)
+{
+    ExprPool *pool = &cc->exprs;
+    if (pool->count == pool->capacity)
+    {
+        if (pool->capacity >= UINT32_MAX / 2)
+        {
+            fprintf(stderr, "Erro: expressões demais\n");
+            failCompilation();
+        }
+        pool->capacity = pool->capacity ? pool->capacity * 2 : 256;
+        pool->type = realloc(pool->type, pool->capacity);
+        pool->op = realloc(pool->op, pool->capacity);
+        pool->need = realloc(pool->need, pool->capacity);
+        pool->left = realloc(pool->left, pool->capacity * sizeof(uint32_t));
+        pool->right = realloc(pool->right, pool->capacity * sizeof(uint32_t));
+        if (!pool->type || !pool->op || !pool->need || !pool->left || !pool->right)
+        {
+            perror("Erro ao alocar memória");
+            failCompilation();
+        }
+    }
+    ExprId node = pool->count++;
+    pool->type[node] = type;
+    pool->op[node] = op;
+    pool->need[node] = -1;
+    pool->left[node] = left;
+    pool->right[node] = right;
+    return node;
+}
+
+/**
+ * createNumExpr – cria nó de número literal
+ */
+ExprId createNumExpr(int value)
+{
+    return newExprNode(EXPR_NUM, 0, (uint32_t)value, 0);
+}
+
+/**
+ * createVarExpr – cria nó de variável, internando o nome
+ */
+ExprId createVarExpr(const char *name)
+{
+    return newExprNode(EXPR_VAR, 0, internSymbol(name, strlen(name)), 0);
+}
+
+/**
+ * createBinOpExpr – cria nó binário (+, -, *, /)
+ */
+ExprId createBinOpExpr(char op, ExprId left, ExprId right)
+{
+    return newExprNode(EXPR_BINOP, op, left, right);
+}
+
+ExprId parseExpr();
+ExprId parseTermExpr();
+ExprId parseFactorExpr();
+
+/**
+ * parseExpr – analisa expressões com + e -
+ */
+ExprId parseExpr()
+{
+    ExprId node = parseTermExpr();
+    LexToken *t;
+    while ((t = peekLexToken()) && (t->type == TOKEN_PLUS || t->type == TOKEN_MINUS))
+    {
+        char op = getLexToken()->lexeme[0];
+        ExprId right = parseTermExpr();
+        node = createBinOpExpr(op, node, right);
+    }
+    return node;
+}
+
+/**
+ * parseTermExpr – analisa expressões com * e /
+ */
+ExprId parseTermExpr()
+{
+    ExprId node = parseFactorExpr();
+    LexToken *t;
+    while ((t = peekLexToken()) && (t->type == TOKEN_TIMES || t->type == TOKEN_DIVIDE))
+    {
+        char op = getLexToken()->lexeme[0];
+        ExprId right = parseFactorExpr();
+        node = createBinOpExpr(op, node, right);
+    }
+    return node;
+}
+
+/**
+ * parseFactorExpr – números, identificadores e parênteses
+ */
+ExprId parseFactorExpr()
+{
+    LexToken *t = peekLexToken();
+    if (t && t->type == TOKEN_LPAREN)
+    {
+        getLexToken();
+        ExprId node = parseExpr();
+        getLexToken();
+        return node;
+    }
+    if (t && t->type == TOKEN_NUM)
+    {
+        t = getLexToken();
+        return createNumExpr(atoi(t->lexeme));
+    }
+    if (t && t->type == TOKEN_IDENT)
+    {
+        t = getLexToken();
+        return createVarExpr(t->lexeme);
+    }
+    fprintf(stderr, "Erro: expressão inválida\n");
+    failCompilation();
+    return 0;
+}
+
+/**
+ * codeLine – representa linha de atribuição
+ */
+typedef struct codeLine
+{
+    int var; /* símbolo atribuído */
+    ExprId expr;
+    struct codeLine *next;
+} codeLine;
+
+/**
+ * parseAssignment – analisa 'IDENT = expression'
+ */
+void parseAssignment()
+{
+    LexToken *t = getLexToken();
+    if (!t || t->type != TOKEN_IDENT)
+    {
+        printf("Aviso: erro na atribuição, token esperado é IDENT\n");
+        return;
+    }
+    int var = internSymbol(t->lexeme, strlen(t->lexeme));
+    LexToken *eq = getLexToken();
+    if (!eq || eq->type != TOKEN_EQ)
+    {
+        printf("Aviso: erro na atribuição, token esperado é '='\n");
+        return;
+    }
+    ExprId expr = parseExpr();
+
+    codeLine *stmt = arenaAlloc(&cc->astArena, sizeof(codeLine));
+    cc->stmtCount++;
+    stmt->var = var;
+    stmt->expr = expr;
+    stmt->next = NULL;
+    if (cc->statements == NULL)
+    {
+        cc->statements = stmt;
+        cc->lastStmt = stmt;
+    }
+    else
+    {
+        cc->lastStmt->next = stmt;
+        cc->lastStmt = stmt;
+    }
+
+    debugLog("Depuração: Atribuição lida -> %s = (expressão)\n", cc->varTable[var].name);
+}
+
+/**
+ * parseCompilationUnit – analisa 'PROGRAMA name : INICIO ... RES = expr FIM'
+ */
+void parseCompilationUnit()
+{
+    LexToken *t = getLexToken();
+    if (!t || t->type != TOKEN_PROGRAM)
+    {
+        printf("Erro: esperado PROGRAMA\n");
+        failCompilation();
+    }
+
+    t = getLexToken();
+    if (!t || t->type != TOKEN_IDENT)
     {
         printf("Erro: esperado nome do programa\n");
-        exit(1);
+        failCompilation();
     }
-    strncpy(program.name, t->lexeme, sizeof(program.name));
-    printf("Depuração: Nome do programa: %s\n", program.name);
+    cc->program.name = arenaStrndup(&cc->astArena, t->lexeme, strlen(t->lexeme));
+    debugLog("Depuração: Nome do programa: %s\n", cc->program.name);
 
     t = getLexToken();
     if (!t || t->type != TOKEN_COLON)
     {
         printf("Erro: esperado ':' após nome\n");
-        exit(1);
+        failCompilation();
     }
 
     t = getLexToken();
     if (!t || t->type != TOKEN_BEGIN)
     {
         printf("Erro: esperado INICIO\n");
-        exit(1);
+        failCompilation();
+    }
+    debugLog("Depuração: Encontrado INICIO\n");
+
+    while (1)
+    {
+        t = peekLexToken();
+        if (!t)
+            break;
+        if (t->type == TOKEN_RES)
+            break;
+        parseAssignment();
+    }
+
+    t = getLexToken();
+    if (!t || t->type != TOKEN_RES)
+    {
+        printf("Erro: esperado RES\n");
+        failCompilation();
+    }
+    debugLog("Depuração: Encontrado RES\n");
+
+    t = getLexToken();
+    if (!t || t->type != TOKEN_EQ)
+    {
+        printf("Erro: esperado '=' após RES\n");
+        failCompilation();
+    }
+    cc->program.resultExpr = parseExpr();
+    debugLog("Depuração: Expressão final (resultado) lida\n");
+
+    t = getLexToken();
+    if (!t || t->type != TOKEN_END)
+    {
+        printf("Erro: esperado FIM\n");
+        failCompilation();
+    }
+    debugLog("Depuração: Encontrado FIM\n");
+}
+
+/**
+ * wrapValue – reduz o valor à largura dos inteiros: 8 bits, ou 16 com --int16
+ */
+int wrapValue(int value)
+{
+    return value & (wideIntegers ? 0xFFFF : 0xFF);
+}
+
+/**
+ * signedValue – o valor lido em complemento de dois na largura dos inteiros
+ */
+int signedValue(int value)
+{
+    return wideIntegers ? (int16_t)value : (int8_t)value;
+}
+
+/**
+ * EvalOpcode – instruções do bytecode de --eval (máquina de pilha de 8 ou 16 bits)
+ *
+ * PUSH tem um imediato de 2 bytes (o literal inteiro, para --int16); LOAD e
+ * STORE, o índice da variável em 2 bytes.
+ */
+typedef enum
+{
+    EVAL_PUSH,
+    EVAL_LOAD,
+    EVAL_STORE,
+    EVAL_ADD,
+    EVAL_SUB,
+    EVAL_MUL,
+    EVAL_DIV,
+    EVAL_HALT
+} EvalOpcode;
+
+/**
+ * EvalCode – bytecode de um programa e as variáveis que ele referencia
+ */
+typedef struct
+{
+    uint8_t *bytes;
+    int size;
+    int capacity;
+    int slotCount; /* variáveis: os ids vão de 0 a slotCount - 1 */
+    int depth; /* altura da pilha no ponto da geração */
+    int maxDepth;
+} EvalCode;
+
+/**
+ * evalEmit – acrescenta um byte ao bytecode
+ */
+void evalEmit(EvalCode *code, uint8_t byte)
+{
+    if (code->size == code->capacity)
+    {
+        code->capacity = code->capacity ? code->capacity * 2 : 256;
+        code->bytes = realloc(code->bytes, code->capacity);
+        if (!code->bytes)
+        {
+            perror("Erro ao alocar memória");
+            failCompilation();
+        }
+    }
+    code->bytes[code->size++] = byte;
+}
+
+/**
+ * evalSlot – índice da variável: o id do símbolo na tabela da compilação
+ */
+int evalSlot(EvalCode *code, int slot)
+{
+    if (slot > 0xFFFF)
+    {
+        fprintf(stderr, "Erro: variáveis demais para --eval\n");
+        failCompilation();
+    }
+    if (slot >= code->slotCount)
+        code->slotCount = slot + 1;
+    return slot;
+}
+
+/**
+ * evalEmitSlot – instrução com operando de 2 bytes (índice de variável ou literal)
+ */
+void evalEmitSlot(EvalCode *code, EvalOpcode op, int slot)
+{
+    evalEmit(code, op);
+    evalEmit(code, slot & 0xFF);
+    evalEmit(code, slot >> 8);
+}
+
+/**
+ * evalCompileExpr – gera o bytecode que deixa o valor da expressão na pilha
+ *
+ * Os operandos ficam na ordem do fonte: a máquina de pilha não tem o custo
+ * de temporários que a ordem de avaliação do IR otimiza.
+ */
+void evalCompileExpr(EvalCode *code, ExprId node)
+{
+    ExprPool *pool = &cc->exprs;
+    switch (pool->type[node])
+    {
+    case EXPR_NUM:
+        evalEmitSlot(code, EVAL_PUSH, wrapValue(pool->left[node]));
+        break;
+    case EXPR_VAR:
+        evalEmitSlot(code, EVAL_LOAD, evalSlot(code, pool->left[node]));
+        break;
+    case EXPR_BINOP:
+        evalCompileExpr(code, pool->left[node]);
+        evalCompileExpr(code, pool->right[node]);
+        evalEmit(code, pool->op[node] == '+'   ? EVAL_ADD
+                       : pool->op[node] == '-' ? EVAL_SUB
+                       : pool->op[node] == '*' ? EVAL_MUL
+                                               : EVAL_DIV);
+        code->depth--;
+        return;
+    }
+    if (++code->depth > code->maxDepth)
+        code->maxDepth = code->depth;
+}
+
+/**
+ * evalCompileProgram – traduz as atribuições e RES para bytecode
+ */
+void evalCompileProgram(EvalCode *code)
+{
+    for (codeLine *stmt = cc->statements; stmt; stmt = stmt->next)
+    {
+        evalCompileExpr(code, stmt->expr);
+        evalEmitSlot(code, EVAL_STORE, evalSlot(code, stmt->var));
+        code->depth--;
+    }
+    evalCompileExpr(code, cc->program.resultExpr);
+    evalEmit(code, EVAL_HALT);
+}
+
+/**
+ * evalRun – executa o bytecode com a semântica do código Neander gerado
+ * @return: valor de RES
+ *
+ * Aritmética de 8 bits com volta em 256 (16 bits e 65536 com --int16); a
+ * divisão é inteira sem sinal e x/0 = 0, como na divisão longa. Variáveis
+ * não atribuídas valem 0 (DB ?).
+ */
+int evalRun(const EvalCode *code)
+{
+    uint16_t *vars = calloc(code->slotCount + 1, sizeof(uint16_t));
+    uint16_t *stack = malloc((code->maxDepth + 1) * sizeof(uint16_t));
+    if (!vars || !stack)
+    {
+        perror("Erro ao alocar memória");
+        failCompilation();
+    }
+    int sp = 0;
+    const uint8_t *pc = code->bytes;
+    uint16_t a, b;
+    for (;;)
+    {
+        switch (*pc++)
+        {
+        case EVAL_PUSH:
+            stack[sp++] = pc[0] | pc[1] << 8;
+            pc += 2;
+            break;
+        case EVAL_LOAD:
+            stack[sp++] = vars[pc[0] | pc[1] << 8];
+            pc += 2;
+            break;
+        case EVAL_STORE:
+            vars[pc[0] | pc[1] << 8] = stack[--sp];
+            pc += 2;
+            break;
+        case EVAL_ADD:
+            b = stack[--sp];
+            stack[sp - 1] = wrapValue(stack[sp - 1] + b);
+            break;
+        case EVAL_SUB:
+            b = stack[--sp];
+            stack[sp - 1] = wrapValue(stack[sp - 1] - b);
+            break;
+        case EVAL_MUL:
+            b = stack[--sp];
+            stack[sp - 1] = wrapValue((unsigned)stack[sp - 1] * b);
+            break;
+        case EVAL_DIV:
+            b = stack[--sp];
+            a = stack[sp - 1];
+            stack[sp - 1] = b ? a / b : 0;
+            break;
+        case EVAL_HALT:
+            a = stack[sp - 1];
+            free(vars);
+            free(stack);
+            return a;
+        }
+    }
+}
+
+/**
+ * evaluateProgram – --eval: compila a AST para bytecode e a executa
+ * @return: valor de RES
+ */
+int evaluateProgram()
+{
+    EvalCode code = {0};
+    evalCompileProgram(&code);
+    debugLog("Depuração: Bytecode: %d bytes, %d variáveis, pilha máxima %d\n", code.size, code.slotCount,
+             code.maxDepth);
+    int result = evalRun(&code);
+    free(code.bytes);
+    return result;
+}
+
+int optimizationLevel = 2; /* -O0, -O1 ou -O2 */
+
+const IrOperand noOperand = {OPND_NONE, 0};
+
+IrOperand constOperand(int value)
+{
+    IrOperand operand = {OPND_CONST, wrapValue(value)};
+    return operand;
+}
+
+IrOperand varOperand(int symbol)
+{
+    IrOperand operand = {OPND_VAR, symbol};
+    return operand;
+}
+
+IrOperand tempOperand(int temp)
+{
+    IrOperand operand = {OPND_TEMP, temp};
+    return operand;
+}
+
+bool sameOperand(IrOperand a, IrOperand b)
+{
+    return a.kind == b.kind && a.value == b.value;
+}
+
+bool isBinaryOp(IrOpcode op)
+{
+    return op == IR_ADD || op == IR_SUB || op == IR_MUL || op == IR_DIV;
+}
+
+/**
+ * emitIr – acrescenta uma instrução ao programa em IR
+ * @return: a instrução, para que o chamador preencha o restante
+ */
+IrInstr *emitIr(IrOpcode op, IrOperand a, IrOperand b)
+{
+    if (cc->ir.count == cc->ir.capacity)
+    {
+        cc->ir.capacity = cc->ir.capacity ? cc->ir.capacity * 2 : 64;
+        cc->ir.code = realloc(cc->ir.code, cc->ir.capacity * sizeof(IrInstr));
+        if (!cc->ir.code)
+        {
+            perror("Erro ao alocar memória");
+            failCompilation();
+        }
+    }
+    IrInstr *instr = &cc->ir.code[cc->ir.count++];
+    instr->op = op;
+    instr->dst = -1;
+    instr->a = a;
+    instr->b = b;
+    instr->var = -1;
+    return instr;
+}
+
+bool isLeaf(ExprId node)
+{
+    return cc->exprs.type[node] != EXPR_BINOP;
+}
+
+/**
+ * registerNeed – número de Sethi–Ullman para uma máquina de um acumulador
+ * @return: temporários simultaneamente vivos para avaliar o nó no AC
+ *
+ * Folhas são operandos de memória e não custam nada. Com os dois lados
+ * compostos, um deles fica guardado enquanto o outro é avaliado: avaliar
+ * primeiro o mais exigente dá max(maior, 1 + menor). Na subtração o
+ * subtraendo precisa estar na memória, então ele é sempre avaliado antes.
+ * O número cresce no máximo um por nível de uma árvore balanceada, então
+ * cabe num byte.
+ */
+int registerNeed(ExprId node)
+{
+    ExprPool *pool = &cc->exprs;
+    if (isLeaf(node))
+        return 0;
+    if (pool->need[node] >= 0)
+        return pool->need[node];
+    ExprId left = pool->left[node], right = pool->right[node];
+    int l = registerNeed(left), r = registerNeed(right), need;
+    if (isLeaf(left) && isLeaf(right))
+        need = 0;
+    else if (isLeaf(right))
+        need = l;
+    else if (isLeaf(left))
+        need = pool->op[node] == '-' ? (r > 1 ? r : 1) : r;
+    else if (pool->op[node] == '-')
+        need = r > 1 + l ? r : 1 + l;
+    else
+        need = l > r ? (l > 1 + r ? l : 1 + r) : (r > 1 + l ? r : 1 + l);
+    pool->need[node] = (int8_t)need;
+    return need;
+}
+
+/**
+ * reassociateSums – reescreve cadeias de '+' na forma encadeada à esquerda
+ *
+ * A soma de 8 bits com volta é associativa e comutativa. Os termos de uma
+ * cadeia são reordenados com os compostos mais exigentes primeiro e as
+ * folhas por último, de modo que cada termo composto é somado a um
+ * acumulado guardado em um único temporário e as folhas entram com ADD.
+ */
+ExprId reassociateSums(ExprId node)
+{
+    if (isLeaf(node))
+        return node;
+    if (cc->exprs.op[node] != '+')
+    {
+        /* os novos nós podem realocar o pool: nada de ponteiros para as colunas aqui */
+        ExprId left = reassociateSums(cc->exprs.left[node]);
+        ExprId right = reassociateSums(cc->exprs.right[node]);
+        cc->exprs.left[node] = left;
+        cc->exprs.right[node] = right;
+        return node;
+    }
+
+    /* coleta os termos da cadeia, percorrendo os nós '+' com uma pilha explícita */
+    int capacity = 16, termCount = 0, top = 0;
+    ExprId *terms = malloc(capacity * sizeof(ExprId));
+    ExprId *stack = malloc(capacity * sizeof(ExprId));
+    if (!terms || !stack)
+    {
+        perror("Erro ao alocar memória");
+        failCompilation();
+    }
+    stack[top++] = node;
+    while (top > 0)
+    {
+        if (top + 2 > capacity || termCount == capacity)
+        {
+            capacity *= 2;
+            stack = realloc(stack, capacity * sizeof(ExprId));
+            terms = realloc(terms, capacity * sizeof(ExprId));
+            if (!terms || !stack)
+            {
+                perror("Erro ao alocar memória");
+                failCompilation();
+            }
+        }
+        ExprId current = stack[--top];
+        if (cc->exprs.type[current] == EXPR_BINOP && cc->exprs.op[current] == '+')
+        {
+            stack[top++] = cc->exprs.right[current];
+            stack[top++] = cc->exprs.left[current];
+        }
+        else
+        {
+            ExprId term = reassociateSums(current);
+            terms[termCount++] = term;
+        }
+    }
+
+    /* ordenação estável: compostos por necessidade decrescente, depois folhas */
+    for (int i = 1; i < termCount; i++)
+    {
+        ExprId term = terms[i];
+        int key = isLeaf(term) ? -1 : registerNeed(term);
+        int j = i;
+        while (j > 0 && (isLeaf(terms[j - 1]) ? -1 : registerNeed(terms[j - 1])) < key)
+        {
+            terms[j] = terms[j - 1];
+            j--;
+        }
+        terms[j] = term;
+    }
+
+    ExprId sum = terms[0];
+    for (int i = 1; i < termCount; i++)
+        sum = createBinOpExpr('+', sum, terms[i]);
+    free(terms);
+    free(stack);
+    return sum;
+}
+
+/**
+ * lowerExpr – traduz uma expressão da AST para IR
+ * @return: operando com o valor da expressão
+ *
+ * A partir de -O1, quando os dois lados são compostos, o mais exigente
+ * (registerNeed) é avaliado primeiro e o outro termina no acumulador; na
+ * subtração o subtraendo vai primeiro, para que o minuendo fique no AC.
+ */
+IrOperand lowerExpr(ExprId node)
+{
+    ExprPool *pool = &cc->exprs;
+    if (pool->type[node] == EXPR_NUM)
+        return constOperand(pool->left[node]);
+    if (pool->type[node] == EXPR_VAR)
+        return varOperand(pool->left[node]);
+
+    ExprId left = pool->left[node], right = pool->right[node];
+    char symbol = pool->op[node];
+    IrOperand a, b;
+    if (optimizationLevel >= 1 && !isLeaf(left) && !isLeaf(right) &&
+        (symbol == '-' || registerNeed(right) > registerNeed(left)))
+    {
+        b = lowerExpr(right);
+        a = lowerExpr(left);
+    }
+    else
+    {
+        a = lowerExpr(left);
+        b = lowerExpr(right);
+    }
+    IrOpcode op = symbol == '+' ? IR_ADD : symbol == '-' ? IR_SUB
+                                       : symbol == '*'   ? IR_MUL
+                                                         : IR_DIV;
+    IrInstr *instr = emitIr(op, a, b);
+    instr->dst = cc->ir.tempCount++;
+    return tempOperand(instr->dst);
+}
+
+/**
+ * lowerProgram – traduz as atribuições e a expressão de RES para IR
+ */
+void lowerProgram()
+{
+    cc->ir.count = 0;
+    cc->ir.tempCount = 0;
+    for (codeLine *stmt = cc->statements; stmt; stmt = stmt->next)
+    {
+        emitIr(IR_STMT, noOperand, noOperand)->var = stmt->var;
+        if (optimizationLevel >= 1)
+            stmt->expr = reassociateSums(stmt->expr);
+        IrOperand value = lowerExpr(stmt->expr);
+        emitIr(IR_STORE, value, noOperand)->var = stmt->var;
+    }
+    emitIr(IR_STMT, noOperand, noOperand);
+    if (optimizationLevel >= 1)
+        cc->program.resultExpr = reassociateSums(cc->program.resultExpr);
+    emitIr(IR_RESULT, lowerExpr(cc->program.resultExpr), noOperand);
+}
+
+/**
+ * formatOperand – texto de um operando para a listagem do IR
+ */
+const char *formatOperand(IrOperand operand, char *buffer)
+{
+    switch (operand.kind)
+    {
+    case OPND_CONST:
+        sprintf(buffer, "%d", operand.value);
+        break;
+    case OPND_VAR:
+        sprintf(buffer, "%.60s", cc->varTable[operand.value].name);
+        break;
+    case OPND_TEMP:
+        sprintf(buffer, "t%d", operand.value);
+        break;
+    default:
+        buffer[0] = '\0';
+    }
+    return buffer;
+}
+
+/**
+ * dumpIr – listagem do IR na saída de depuração
+ */
+void dumpIr(const char *title)
+{
+    if (!verbose)
+        return;
+    static const char opSymbol[] = {[IR_ADD] = '+', [IR_SUB] = '-', [IR_MUL] = '*', [IR_DIV] = '/'};
+    char a[64], b[64];
+    printf("Depuração: IR %s (%d instruções)\n", title, cc->ir.count);
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        IrInstr *instr = &cc->ir.code[i];
+        switch (instr->op)
+        {
+        case IR_COPY:
+            printf("    t%d = %s\n", instr->dst, formatOperand(instr->a, a));
+            break;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+            printf("    t%d = %s %c %s\n", instr->dst, formatOperand(instr->a, a), opSymbol[instr->op],
+                   formatOperand(instr->b, b));
+            break;
+        case IR_STORE:
+            printf("    %s = %s\n", cc->varTable[instr->var].name, formatOperand(instr->a, a));
+            break;
+        case IR_RESULT:
+            printf("    RES = %s\n", formatOperand(instr->a, a));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * ConstBinding – valor conhecido de uma variável durante a propagação
+ */
+typedef struct ConstBinding
+{
+    int value;
+    bool known;
+} ConstBinding;
+
+IrOperand substOperand(IrOperand operand)
+{
+    if (operand.kind == OPND_TEMP && cc->tempSubst[operand.value].kind != OPND_NONE)
+        return cc->tempSubst[operand.value];
+    return operand;
+}
+
+void resetTempSubst()
+{
+    cc->tempSubst = arenaAlloc(&cc->astArena, (cc->ir.tempCount + 1) * sizeof(IrOperand));
+    for (int i = 0; i < cc->ir.tempCount; i++)
+        cc->tempSubst[i] = noOperand;
+}
+
+/**
+ * foldBinary – dobra dst = a op b com operandos já substituídos
+ * @result: recebe o operando equivalente, se houver
+ * @return: true se a instrução se reduz a result
+ *
+ * Aritmética de 8 bits com volta (16 com --int16); a divisão é sem sinal e
+ * x / 0 = 0, como no código gerado. Simplifica x+0, x-0, x-x, x*0, x*1, 0/x
+ * e x/1.
+ */
+bool foldBinary(IrInstr *instr, IrOperand *result)
+{
+    IrOperand a = instr->a, b = instr->b;
+    int l = a.kind == OPND_CONST ? a.value : -1;
+    int r = b.kind == OPND_CONST ? b.value : -1;
+
+    if (instr->op == IR_DIV && r == 0)
+    {
+        fprintf(stderr, "Erro: Divisão por zero\n");
+        *result = constOperand(0);
+        return true;
+    }
+    if (l >= 0 && r >= 0)
+    {
+        /* sem sinal: l * r de 16 bits não cabe num int */
+        int value = instr->op == IR_ADD   ? l + r
+                    : instr->op == IR_SUB ? l - r
+                    : instr->op == IR_MUL ? (int)(((unsigned)l * r) & 0xFFFF)
+                                          : l / r;
+        *result = constOperand(value);
+        return true;
+    }
+    switch (instr->op)
+    {
+    case IR_ADD:
+        if (l == 0 || r == 0)
+        {
+            *result = l == 0 ? b : a;
+            return true;
+        }
+        break;
+    case IR_SUB:
+        if (r == 0 || sameOperand(a, b))
+        {
+            *result = r == 0 ? a : constOperand(0);
+            return true;
+        }
+        break;
+    case IR_MUL:
+        if (l == 0 || r == 0 || l == 1 || r == 1)
+        {
+            *result = (l == 0 || r == 0) ? constOperand(0) : l == 1 ? b
+                                                                    : a;
+            return true;
+        }
+        break;
+    case IR_DIV:
+        if (l == 0 || r == 1)
+        {
+            *result = l == 0 ? constOperand(0) : a;
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
+/**
+ * storedBefore – a variável é reatribuída entre a instrução from e to?
+ */
+bool storedBefore(int var, int from, int to)
+{
+    for (int i = from + 1; i < to; i++)
+    {
+        if (cc->ir.code[i].op == IR_STORE && cc->ir.code[i].var == var)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * foldConstantsPass – propagação e dobra de constantes sobre o IR
+ *
+ * O programa é linear, então uma passada em ordem basta. Temporários cujo
+ * valor se reduz a uma constante, a outro temporário ou a uma variável que
+ * não é reatribuída até o último uso são substituídos nos usos; senão, a
+ * instrução vira uma cópia. Atribuições de constantes tornam a variável
+ * conhecida até a próxima atribuição; o armazenamento em si fica para a
+ * eliminação de código morto.
+ */
+void foldConstantsPass()
+{
+    resetTempSubst();
+    cc->bindings = arenaAlloc(&cc->astArena, (cc->varCount + 1) * sizeof(ConstBinding));
+    memset(cc->bindings, 0, (cc->varCount + 1) * sizeof(ConstBinding));
+    int *lastUse = arenaAlloc(&cc->astArena, (cc->ir.tempCount + 1) * sizeof(int));
+    for (int t = 0; t < cc->ir.tempCount; t++)
+        lastUse[t] = -1;
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        if (cc->ir.code[i].a.kind == OPND_TEMP)
+            lastUse[cc->ir.code[i].a.value] = i;
+        if (cc->ir.code[i].b.kind == OPND_TEMP)
+            lastUse[cc->ir.code[i].b.value] = i;
+    }
+
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        IrInstr *instr = &cc->ir.code[i];
+        instr->a = substOperand(instr->a);
+        instr->b = substOperand(instr->b);
+        for (IrOperand *operand = &instr->a; operand <= &instr->b; operand++)
+        {
+            if (operand->kind == OPND_VAR && cc->bindings[operand->value].known)
+                *operand = constOperand(cc->bindings[operand->value].value);
+        }
+
+        IrOperand result;
+        if (isBinaryOp(instr->op) && foldBinary(instr, &result))
+        {
+            instr->op = IR_COPY;
+            instr->a = result;
+            instr->b = noOperand;
+        }
+        if (instr->op == IR_COPY &&
+            (instr->a.kind != OPND_VAR || !storedBefore(instr->a.value, i, lastUse[instr->dst])))
+        {
+            cc->tempSubst[instr->dst] = instr->a;
+            instr->op = IR_NOP;
+        }
+        else if (instr->op == IR_STORE)
+        {
+            ConstBinding *binding = &cc->bindings[instr->var];
+            binding->known = instr->a.kind == OPND_CONST;
+            binding->value = instr->a.value;
+        }
+    }
+}
+
+/**
+ * markOperandLive – o valor corrente da variável (liveVars) ou o temporário ainda pode chegar a RES
+ */
+void markOperandLive(IrOperand operand, bool *tempUsed)
+{
+    if (operand.kind == OPND_VAR)
+        cc->liveVars[operand.value] = true;
+    else if (operand.kind == OPND_TEMP)
+        tempUsed[operand.value] = true;
+}
+
+/**
+ * deadCodePass – remove instruções que não podem afetar RES
+ *
+ * Percorre o IR de trás para frente a partir de RES: um armazenamento só é
+ * mantido se a variável estiver viva naquele ponto (e então a mata), e um
+ * temporário só é calculado se algum uso mantido o ler. Variáveis que só
+ * apareciam em código removido deixam de ter declaração no .DATA, pois os
+ * símbolos só são declarados durante a seleção de instruções.
+ */
+void deadCodePass()
+{
+    bool *tempUsed = arenaAlloc(&cc->astArena, cc->ir.tempCount + 1);
+    memset(tempUsed, 0, cc->ir.tempCount + 1);
+    cc->liveVars = arenaAlloc(&cc->astArena, cc->varCount + 1);
+    memset(cc->liveVars, 0, cc->varCount + 1);
+
+    int keptSinceMarker = 0;
+    for (int i = cc->ir.count - 1; i >= 0; i--)
+    {
+        IrInstr *instr = &cc->ir.code[i];
+        bool keep = true;
+        switch (instr->op)
+        {
+        case IR_STMT:
+            /* marcador de uma atribuição que não gerou código */
+            keep = instr->var < 0 || keptSinceMarker > 0;
+            keptSinceMarker = 0;
+            break;
+        case IR_STORE:
+            keep = cc->liveVars[instr->var];
+            cc->liveVars[instr->var] = false;
+            break;
+        case IR_RESULT:
+            break;
+        case IR_NOP:
+            keep = false;
+            break;
+        default:
+            keep = tempUsed[instr->dst];
+            break;
+        }
+        if (!keep)
+        {
+            if (instr->op == IR_STORE)
+                debugLog("Depuração: Atribuição morta removida -> %s\n", cc->varTable[instr->var].name);
+            instr->op = IR_NOP;
+            continue;
+        }
+        if (instr->op != IR_STMT)
+            keptSinceMarker++;
+        markOperandLive(instr->a, tempUsed);
+        markOperandLive(instr->b, tempUsed);
+    }
+}
+
+/**
+ * ValueEntry – entrada da tabela de numeração de valores (endereçamento aberto)
+ */
+typedef struct
+{
+    int instr;     /* índice da instrução que calcula o valor; -1 se livre */
+    int versionA;  /* versões das variáveis lidas, quando os operandos são OPND_VAR */
+    int versionB;
+} ValueEntry;
+
+/**
+ * operandVersion – atribuições já vistas da variável lida (0 se nunca atribuída)
+ */
+int operandVersion(IrOperand operand)
+{
+    return operand.kind == OPND_VAR ? cc->versions[operand.value] : 0;
+}
+
+size_t hashOperand(size_t hash, IrOperand operand, int version)
+{
+    hash = (hash ^ (size_t)operand.kind) * 16777619u;
+    hash = (hash ^ (size_t)operand.value) * 16777619u;
+    return operand.kind == OPND_VAR ? (hash ^ (size_t)version) * 16777619u : hash;
+}
+
+bool isCommutative(IrOpcode op)
+{
+    return op == IR_ADD || op == IR_MUL;
+}
+
+/**
+ * sameValue – a instrução da entrada calcula o mesmo valor que instr?
+ */
+bool sameValue(ValueEntry *entry, IrInstr *instr, int versionA, int versionB)
+{
+    IrInstr *other = &cc->ir.code[entry->instr];
+    if (other->op != instr->op)
+        return false;
+    if (sameOperand(other->a, instr->a) && entry->versionA == versionA &&
+        sameOperand(other->b, instr->b) && entry->versionB == versionB)
+        return true;
+    return isCommutative(instr->op) &&
+           sameOperand(other->a, instr->b) && entry->versionA == versionB &&
+           sameOperand(other->b, instr->a) && entry->versionB == versionA;
+}
+
+/**
+ * valueNumberingPass – eliminação de subexpressões comuns entre atribuições
+ *
+ * Cada variável ganha uma nova versão a cada atribuição, então instruções
+ * com o mesmo operador sobre os mesmos operandos (e versões) calculam o
+ * mesmo valor; + e * são comutativos. A repetição é removida e seus usos
+ * passam a ler o temporário da primeira ocorrência. Somas e subtrações de
+ * dois operandos de memória não são reaproveitadas: recalcular custa o
+ * mesmo que guardar e recarregar o temporário.
+ */
+void valueNumberingPass()
+{
+    resetTempSubst();
+    size_t tableSize = 16;
+    while (tableSize < (size_t)cc->ir.count * 2)
+        tableSize *= 2;
+    ValueEntry *table = arenaAlloc(&cc->astArena, tableSize * sizeof(ValueEntry));
+    for (size_t i = 0; i < tableSize; i++)
+        table[i].instr = -1;
+    cc->versions = arenaAlloc(&cc->astArena, (cc->varCount + 1) * sizeof(int));
+    memset(cc->versions, 0, (cc->varCount + 1) * sizeof(int));
+
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        IrInstr *instr = &cc->ir.code[i];
+        instr->a = substOperand(instr->a);
+        instr->b = substOperand(instr->b);
+        if (instr->op == IR_STORE)
+        {
+            cc->versions[instr->var]++;
+            continue;
+        }
+        if (!isBinaryOp(instr->op))
+            continue;
+        if ((instr->op == IR_ADD || instr->op == IR_SUB) &&
+            instr->a.kind != OPND_TEMP && instr->b.kind != OPND_TEMP)
+            continue;
+
+        int versionA = operandVersion(instr->a), versionB = operandVersion(instr->b);
+        size_t hashA = hashOperand(2166136261u, instr->a, versionA);
+        size_t hashB = hashOperand(2166136261u, instr->b, versionB);
+        /* combinação simétrica para operadores comutativos */
+        size_t hash = isCommutative(instr->op) ? (hashA ^ hashB) : (hashA * 31 + hashB);
+        hash = (hash ^ (size_t)instr->op) * 16777619u;
+
+        size_t slot = hash & (tableSize - 1);
+        while (table[slot].instr >= 0 && !sameValue(&table[slot], instr, versionA, versionB))
+            slot = (slot + 1) & (tableSize - 1);
+        if (table[slot].instr >= 0)
+        {
+            cc->tempSubst[instr->dst] = tempOperand(cc->ir.code[table[slot].instr].dst);
+            debugLog("Depuração: Subexpressão comum: t%d reaproveita t%d\n", instr->dst,
+                     cc->ir.code[table[slot].instr].dst);
+            instr->op = IR_NOP;
+            continue;
+        }
+        table[slot].instr = i;
+        table[slot].versionA = versionA;
+        table[slot].versionB = versionB;
+    }
+}
+
+/**
+ * ValueRange – intervalo [lo, hi] de valores sem sinal que um operando pode ter
+ */
+typedef struct ValueRange
+{
+    int lo;
+    int hi;
+} ValueRange;
+
+/**
+ * fullRange – qualquer valor da largura dos inteiros
+ */
+ValueRange fullRange()
+{
+    ValueRange range = {0, wrapValue(-1)};
+    return range;
+}
+
+/**
+ * knownRange – intervalo do valor corrente do operando segundo a análise
+ */
+ValueRange knownRange(IrOperand operand)
+{
+    ValueRange range = fullRange();
+    if (operand.kind == OPND_CONST)
+        range.lo = range.hi = operand.value;
+    else if (operand.kind == OPND_TEMP && cc->tempRanges)
+        range = cc->tempRanges[operand.value];
+    else if (operand.kind == OPND_VAR && cc->varRanges && operand.value < cc->rangeVarCount)
+        range = cc->varRanges[operand.value];
+    return range;
+}
+
+/**
+ * operandRange – intervalo do operando para a geração de código
+ *
+ * Em -O0 a geração de código não usa os intervalos: todo operando não
+ * constante vale qualquer coisa.
+ */
+ValueRange operandRange(IrOperand operand)
+{
+    if (optimizationLevel == 0 && operand.kind != OPND_CONST)
+        return fullRange();
+    return knownRange(operand);
+}
+
+/**
+ * wrapCount – quantas vezes o valor dá a volta na largura dos inteiros (com piso)
+ */
+long long wrapCount(long long value)
+{
+    long long span = (long long)wrapValue(-1) + 1;
+    return value >= 0 ? value / span : -((-value + span - 1) / span);
+}
+
+/**
+ * binaryRange – intervalo do resultado de uma operação aritmética
+ * @exactLo, @exactHi: recebem os limites antes da volta (sem a divisão)
+ *
+ * Se os dois limites dão o mesmo número de voltas, o intervalo continua
+ * contíguo depois da volta; senão pode ser qualquer valor. A divisão é sem
+ * sinal e x / 0 = 0, então um divisor que pode ser zero inclui o 0.
+ */
+ValueRange binaryRange(IrOpcode op, ValueRange a, ValueRange b, long long *exactLo, long long *exactHi)
+{
+    long long lo, hi;
+    switch (op)
+    {
+    case IR_ADD:
+        lo = (long long)a.lo + b.lo;
+        hi = (long long)a.hi + b.hi;
+        break;
+    case IR_SUB:
+        lo = (long long)a.lo - b.hi;
+        hi = (long long)a.hi - b.lo;
+        break;
+    case IR_MUL:
+        lo = (long long)a.lo * b.lo;
+        hi = (long long)a.hi * b.hi;
+        break;
+    default:
+        lo = b.lo > 0 ? a.lo / b.hi : 0;
+        hi = b.hi == 0 ? 0 : a.hi / (b.lo > 0 ? b.lo : 1);
+        break;
+    }
+    *exactLo = lo;
+    *exactHi = hi;
+    ValueRange range = fullRange();
+    if (wrapCount(lo) == wrapCount(hi))
+    {
+        range.lo = (int)(lo - wrapCount(lo) * (range.hi + 1LL));
+        range.hi = (int)(hi - wrapCount(hi) * (range.hi + 1LL));
+    }
+    return range;
+}
+
+/**
+ * updateVarRange – registra o intervalo do valor guardado por IR_STORE
+ */
+void updateVarRange(IrInstr *instr)
+{
+    if (cc->varRanges && instr->var < cc->rangeVarCount)
+        cc->varRanges[instr->var] = knownRange(instr->a);
+}
+
+/**
+ * analyzeRanges – análise de intervalos sobre o IR
+ *
+ * Roda sobre o IR recém-traduzido, em todos os níveis de -O. Variáveis não
+ * atribuídas são entradas (DB ?) e valem qualquer coisa; cada temporário
+ * recebe o intervalo da sua operação, que os passes não alteram (o valor de
+ * um temporário SSA é o mesmo antes e depois deles). Avisa quando uma soma
+ * ou multiplicação estoura com certeza, qualquer que seja a entrada. A
+ * geração de código percorre o IR final atualizando varRanges a cada
+ * IR_STORE e escolhe, pelos intervalos, o operando que conduz os laços de
+ * multiplicação e divisão e quais testes do divisor emitir.
+ */
+void analyzeRanges()
+{
+    cc->rangeVarCount = cc->varCount;
+    cc->tempRanges = arenaAlloc(&cc->astArena, (cc->ir.tempCount + 1) * sizeof(ValueRange));
+    cc->varRanges = arenaAlloc(&cc->astArena, (cc->rangeVarCount + 1) * sizeof(ValueRange));
+    for (int id = 0; id < cc->rangeVarCount; id++)
+        cc->varRanges[id] = fullRange();
+
+    int statementVar = -1;
+    int bounded = 0;
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        IrInstr *instr = &cc->ir.code[i];
+        if (instr->op == IR_STMT)
+        {
+            statementVar = instr->var;
+        }
+        else if (instr->op == IR_STORE)
+        {
+            updateVarRange(instr);
+        }
+        else if (instr->op == IR_COPY)
+        {
+            cc->tempRanges[instr->dst] = knownRange(instr->a);
+        }
+        else if (isBinaryOp(instr->op))
+        {
+            long long lo, hi;
+            ValueRange range = binaryRange(instr->op, knownRange(instr->a), knownRange(instr->b), &lo, &hi);
+            cc->tempRanges[instr->dst] = range;
+            if ((instr->op == IR_ADD || instr->op == IR_MUL) && wrapCount(lo) > 0)
+                fprintf(stderr, "Aviso: %s: estouro certo em %s = ...: a %s vale de %lld a %lld, acima de %d\n",
+                        cc->inputFile, statementVar >= 0 ? cc->varTable[statementVar].name : "RES",
+                        instr->op == IR_ADD ? "soma" : "multiplicação", lo, hi, fullRange().hi);
+            if (range.hi - range.lo < fullRange().hi)
+                bounded++;
+        }
+    }
+    debugLog("Depuração: Intervalos: %d de %d temporários com valor limitado\n", bounded, cc->ir.tempCount);
+
+    /* a geração de código refaz varRanges na ordem do IR final */
+    for (int id = 0; id < cc->rangeVarCount; id++)
+        cc->varRanges[id] = fullRange();
+}
+
+/**
+ * IrPass – otimização registrada no gerenciador de passes
+ */
+typedef struct
+{
+    const char *name;
+    int level; /* nível mínimo de -O em que o passe roda */
+    void (*run)(void);
+} IrPass;
+
+const IrPass irPasses[] = {
+    {"propagação de constantes", 1, foldConstantsPass},
+    {"subexpressões comuns", 2, valueNumberingPass},
+    {"propagação de constantes", 2, foldConstantsPass},
+    {"código morto", 1, deadCodePass},
+};
+
+/**
+ * compactIr – remove as instruções IR_NOP deixadas pelos passes
+ */
+void compactIr()
+{
+    int count = 0;
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        if (cc->ir.code[i].op != IR_NOP)
+            cc->ir.code[count++] = cc->ir.code[i];
+    }
+    cc->ir.count = count;
+}
+
+/**
+ * runPasses – executa, em ordem, os passes habilitados pelo nível de -O
+ *
+ * A análise de intervalos roda antes, sobre o IR ainda sem otimizações.
+ */
+void runPasses()
+{
+    dumpIr("inicial");
+    analyzeRanges();
+    for (size_t p = 0; p < sizeof(irPasses) / sizeof(irPasses[0]); p++)
+    {
+        if (irPasses[p].level > optimizationLevel)
+            continue;
+        int before = cc->ir.count;
+        irPasses[p].run();
+        compactIr();
+        debugLog("Depuração: Passe %s: %d -> %d instruções\n", irPasses[p].name, before, cc->ir.count);
+    }
+    dumpIr("otimizado");
+}
+
+/**
+ * declareSymbol – marca o símbolo como usado pelo código, para entrar no .DATA
+ */
+void declareSymbol(int id)
+{
+    Var *var = &cc->varTable[id];
+    if (var->declared)
+        return;
+    var->declared = true;
+    if (!var->reserved)
+        cc->dataSymbols[cc->dataSymbolCount++] = id;
+    debugLog("Depuração: Símbolo adicionado -> %s\n", var->name);
+}
+
+/**
+ * ensureConstantExists – garante que CONST_<value> esteja na tabela e no .DATA
+ * @return: id do símbolo
+ *
+ * O pool de constantes é indexado pelo valor, então o nome só é formatado
+ * na primeira vez em que a constante aparece.
+ */
+int ensureConstantExists(int value)
+{
+    int id = cc->constSymbol[value & 0xFF] - 1;
+    if (id < 0)
+    {
+        char constName[16];
+        int len = sprintf(constName, "CONST_%d", value & 0xFF);
+        id = internSymbol(constName, len);
+        cc->varTable[id].value = value & 0xFF;
+        cc->varTable[id].defined = true;
+        cc->constSymbol[value & 0xFF] = id + 1;
+        debugLog("Depuração: Atualizado %s com valor %d\n", constName, value & 0xFF);
+    }
+    declareSymbol(id);
+    return id;
+}
+
+/**
+ * newTemp – gera nome TEMP_<n> para operação intermediária
+ *
+ * Os TEMP_ virtuais não entram na tabela de variáveis: o .DATA declara só os
+ * slots calculados por allocateTemps.
+ */
+void newTemp(char *buffer)
+{
+    sprintf(buffer, "TEMP_%d", cc->tempCount++);
+}
+
+
+
+void acClear()
+{
+    cc->acAliasCount = 0;
+}
+
+bool acHas(IrOperand operand)
+{
+    for (int i = 0; i < cc->acAliasCount; i++)
+    {
+        if (sameOperand(cc->acAliases[i], operand))
+            return true;
+    }
+    return false;
+}
+
+void acAdd(IrOperand operand)
+{
+    if (!acHas(operand) && cc->acAliasCount < MAX_AC_ALIASES)
+        cc->acAliases[cc->acAliasCount++] = operand;
+}
+
+/**
+ * operandName – nome do operando de memória (declarando-o se preciso)
+ * @operand: constante, variável ou temporário com TEMP_ atribuído
+ * @buffer: recebe TEMP_<n>
+ */
+const char *operandName(IrOperand operand, char *buffer)
+{
+    switch (operand.kind)
+    {
+    case OPND_CONST:
+    {
+        /* ensureConstantExists pode realocar varTable */
+        int id = ensureConstantExists(operand.value);
+        return cc->varTable[id].name;
+    }
+    case OPND_VAR:
+        declareSymbol(operand.value);
+        return cc->varTable[operand.value].name;
+    case OPND_TEMP:
+        if (cc->irTempHome[operand.value] < 0)
+        {
+            fprintf(stderr, "Erro interno: t%d lido da memória sem ter sido guardado\n", operand.value);
+            failCompilation();
+        }
+        sprintf(buffer, "TEMP_%d", cc->irTempHome[operand.value]);
+        return buffer;
+    default:
+        break;
+    }
+    return "?";
+}
+
+/**
+ * emitLoad – coloca o operando no acumulador, se ele já não estiver lá
+ */
+void emitLoad(IrOperand operand)
+{
+    if (acHas(operand))
+        return;
+    char buffer[64];
+    fprintf(cc->asmOut, "LDA %s\n", operandName(operand, buffer));
+    acClear();
+    acAdd(operand);
+}
+
+/**
+ * mutableCopy – posição de memória com o valor do operando que a rotina pode modificar
+ * @buffer: recebe o nome do TEMP_
+ *
+ * Um temporário guardado e lido só por esta instrução é modificado no
+ * próprio TEMP_; os demais operandos são copiados para um TEMP_ novo.
+ */
+const char *mutableCopy(IrOperand operand, char *buffer)
+{
+    if (operand.kind == OPND_TEMP && cc->irTempHome[operand.value] >= 0 && cc->irTempUses[operand.value] == 1)
+        return operandName(operand, buffer);
+    newTemp(buffer);
+    emitLoad(operand);
+    fprintf(cc->asmOut, "STA %s\n", buffer);
+    return buffer;
+}
+
+/**
+ * readOnlyCopy – nome de memória do operando, copiando-o só se estiver apenas no AC
+ */
+const char *readOnlyCopy(IrOperand operand, char *buffer)
+{
+    if (operand.kind != OPND_TEMP || cc->irTempHome[operand.value] >= 0)
+        return operandName(operand, buffer);
+    newTemp(buffer);
+    emitLoad(operand);
+    fprintf(cc->asmOut, "STA %s\n", buffer);
+    return buffer;
+}
+
+/**
+ * MulStrategy – formas de gerar a multiplicação por uma constante k
+ */
+typedef enum
+{
+    MUL_REPEATED_ADD, /* LDA m; ADD m (k-1 vezes) */
+    MUL_SHIFT_ADD,    /* Horner sobre os bits de k: dobra com STA t/ADD t, soma m nos bits 1 */
+    MUL_LOOP          /* laço de deslocamento e soma em tempo de execução */
+} MulStrategy;
+
+/* peso do tamanho frente aos ciclos: o código divide 126 palavras com nada mais */
+#define MUL_SIZE_WEIGHT 4
+
+int bitLength(int value)
+{
+    int bits = 0;
+    while (value >> bits)
+        bits++;
+    return bits;
+}
+
+int popCount(int value)
+{
+    int count = 0;
+    for (; value; value &= value - 1)
+        count++;
+    return count;
+}
+
+/**
+ * estimateMultiplyCost – instruções emitidas e executadas para m * k
+ * @k: multiplicador constante (2..255)
+ * @strategy: estratégia avaliada
+ * @size: recebe o número de instruções
+ * @cycles: recebe o número de instruções executadas (pior caso)
+ */
+void estimateMultiplyCost(int k, MulStrategy strategy, int *size, int *cycles)
+{
+    int bits = bitLength(k), ones = popCount(k);
+    switch (strategy)
+    {
+    case MUL_REPEATED_ADD:
+        *size = *cycles = k;
+        break;
+    case MUL_SHIFT_ADD:
+        *size = *cycles = 1 + 2 * (bits - 1) + (ones - 1);
+        break;
+    case MUL_LOOP:
+        /* 7 de preparação, 17 por iteração, 1 de saída; bits 1 custam 17, bits 0 custam 11 */
+        *size = 7 + 17 + 1;
+        *cycles = 7 + 17 * ones + 11 * (bits - ones) + 2 + 1;
+        break;
+    }
+}
+
+/**
+ * emitUnsignedBelow – desvia para below se x < y sem sinal, senão para other
+ * @x: palavra de 8 bits
+ * @y: palavra de 8 bits
+ */
+void emitUnsignedBelow(const char *x, const char *y, const char *below, const char *other)
+{
+    int id = cc->labelCounter++;
+    fprintf(cc->asmOut, "LDA %s\n", x);
+    fprintf(cc->asmOut, "JMN ULT_XN_%d\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", y);
+    fprintf(cc->asmOut, "JMN %s\n", below);
+    fprintf(cc->asmOut, "JMP ULT_SAME_%d\n", id);
+    fprintf(cc->asmOut, "ULT_XN_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", y);
+    fprintf(cc->asmOut, "JMN ULT_SAME_%d\n", id);
+    fprintf(cc->asmOut, "JMP %s\n", other);
+    fprintf(cc->asmOut, "ULT_SAME_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", x);
+    fprintf(cc->asmOut, "SUB %s\n", y);
+    fprintf(cc->asmOut, "JMN %s\n", below);
+    fprintf(cc->asmOut, "JMP %s\n", other);
+}
+
+/**
+ * MulCounter – operando que conduz o laço de multiplicação
+ */
+typedef enum
+{
+    MUL_COUNT_RIGHT,  /* o multiplicador */
+    MUL_COUNT_LEFT,   /* o multiplicando: pelo intervalo, tem menos bits */
+    MUL_COUNT_SMALLER /* troca em tempo de execução para que o menor conduza */
+} MulCounter;
+
+/**
+ * chooseMultiplyCounter – operando que minimiza as iterações no pior caso
+ *
+ * O laço dá bitLength(contador) voltas, então conduz o operando cujo
+ * limite superior tem menos bits. Com limites do mesmo tamanho o pior caso
+ * é igual, e a troca em tempo de execução ainda ajuda na média.
+ */
+MulCounter chooseMultiplyCounter(IrOperand left, IrOperand right)
+{
+    int leftBits = bitLength(operandRange(left).hi);
+    int rightBits = bitLength(operandRange(right).hi);
+    if (leftBits == rightBits)
+        return MUL_COUNT_SMALLER;
+    debugLog("Depuração: Multiplicação: o operando %s conduz o laço (até %d voltas)\n",
+             leftBits < rightBits ? "esquerdo" : "direito", leftBits < rightBits ? leftBits : rightBits);
+    return leftBits < rightBits ? MUL_COUNT_LEFT : MUL_COUNT_RIGHT;
+}
+
+/**
+ * emitMultiplyLoop – multiplicação em tempo de execução por deslocamento e soma
+ * @left: multiplicando
+ * @right: multiplicador
+ * @counter: operando que controla o laço
+ *
+ * Testa os bits do contador com uma máscara que dobra (ADD consigo mesma) e
+ * apaga cada bit testado; o laço termina quando o contador zera, ou seja,
+ * após bitLength(contador) iterações, no máximo 8. Os operandos são sempre
+ * copiados na ordem esquerdo, direito, como readsTempFromAc espera.
+ */
+void emitMultiplyLoop(IrOperand left, IrOperand right, MulCounter counter)
+{
+    char mBuffer[64], nBuffer[64], p[64], mask[64];
+    const char *m = mutableCopy(left, mBuffer);
+    const char *n = mutableCopy(right, nBuffer);
+    if (counter == MUL_COUNT_LEFT)
+    {
+        const char *swap = m;
+        m = n;
+        n = swap;
+    }
+    newTemp(p);
+    newTemp(mask);
+    ensureConstantExists(0);
+    ensureConstantExists(1);
+
+    int id = cc->labelCounter++;
+
+    if (counter == MUL_COUNT_SMALLER)
+    {
+        /* m < n sem sinal: troca, usando p como auxiliar; SUB e JMN sozinhos
+         * comparariam com sinal e errariam com operandos distantes 128 ou mais */
+        char swapLabel[32], initLabel[32];
+        snprintf(swapLabel, sizeof(swapLabel), "MUL_SWAP_%d", id);
+        snprintf(initLabel, sizeof(initLabel), "MUL_INIT_%d", id);
+        emitUnsignedBelow(m, n, swapLabel, initLabel);
+        fprintf(cc->asmOut, "MUL_SWAP_%d:\n", id);
+        fprintf(cc->asmOut, "LDA %s\n", n);
+        fprintf(cc->asmOut, "STA %s\n", p);
+        fprintf(cc->asmOut, "LDA %s\n", m);
+        fprintf(cc->asmOut, "STA %s\n", n);
+        fprintf(cc->asmOut, "LDA %s\n", p);
+        fprintf(cc->asmOut, "STA %s\n", m);
+        fprintf(cc->asmOut, "MUL_INIT_%d:\n", id);
+    }
+    fprintf(cc->asmOut, "LDA CONST_0\n");
+    fprintf(cc->asmOut, "STA %s\n", p);
+    fprintf(cc->asmOut, "LDA CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", mask);
+    fprintf(cc->asmOut, "MUL_LOOP_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", n);
+    fprintf(cc->asmOut, "JMZ MUL_DONE_%d\n", id);
+    fprintf(cc->asmOut, "AND %s\n", mask);
+    fprintf(cc->asmOut, "JMZ MUL_SKIP_%d\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", n);
+    fprintf(cc->asmOut, "SUB %s\n", mask);
+    fprintf(cc->asmOut, "STA %s\n", n);
+    fprintf(cc->asmOut, "LDA %s\n", p);
+    fprintf(cc->asmOut, "ADD %s\n", m);
+    fprintf(cc->asmOut, "STA %s\n", p);
+    fprintf(cc->asmOut, "MUL_SKIP_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", m);
+    fprintf(cc->asmOut, "ADD %s\n", m);
+    fprintf(cc->asmOut, "STA %s\n", m);
+    fprintf(cc->asmOut, "LDA %s\n", mask);
+    fprintf(cc->asmOut, "ADD %s\n", mask);
+    fprintf(cc->asmOut, "STA %s\n", mask);
+    fprintf(cc->asmOut, "JMP MUL_LOOP_%d\n", id);
+    fprintf(cc->asmOut, "MUL_DONE_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", p);
+}
+
+/**
+ * emitMultiplyCode – gera a multiplicação escolhendo a estratégia mais barata
+ *
+ * Com um fator constante k, compara soma repetida, deslocamento e soma
+ * desdobrado e o laço pelo custo tamanho * MUL_SIZE_WEIGHT + ciclos; se o
+ * intervalo do outro fator tem menos bits que k, o laço conduzido por ele
+ * também concorre. Sem fator conhecido, emite o laço em tempo de execução.
+ */
+void emitMultiplyCode(IrOperand left, IrOperand right)
+{
+    int leftValue = left.kind == OPND_CONST ? left.value : -1;
+    int rightValue = right.kind == OPND_CONST ? right.value : -1;
+
+    if (leftValue < 0 && rightValue < 0)
+    {
+        debugLog("Depuração: Multiplicação em tempo de execução (laço)\n");
+        emitMultiplyLoop(left, right, chooseMultiplyCounter(left, right));
+        return;
+    }
+
+    /* o fator constante (o menor, se ambos forem conhecidos) guia a geração */
+    IrOperand operand = left;
+    int k = rightValue;
+    if (rightValue < 0 || (leftValue >= 0 && leftValue < rightValue))
+    {
+        operand = right;
+        k = leftValue;
+    }
+
+    if (k == 0)
+    {
+        emitLoad(constOperand(0));
+        return;
+    }
+    if (k == 1)
+    {
+        emitLoad(operand);
+        return;
+    }
+
+    MulStrategy best = MUL_REPEATED_ADD;
+    int bestCost = -1;
+    for (MulStrategy strategy = MUL_REPEATED_ADD; strategy <= MUL_LOOP; strategy++)
+    {
+        int size, cycles;
+        estimateMultiplyCost(k, strategy, &size, &cycles);
+        int cost = size * MUL_SIZE_WEIGHT + cycles;
+        if (bestCost < 0 || cost < bestCost)
+        {
+            best = strategy;
+            bestCost = cost;
+        }
+    }
+    int operandBits = bitLength(operandRange(operand).hi);
+    bool operandCounts = false;
+    if (operandBits < bitLength(k))
+    {
+        int size, cycles;
+        estimateMultiplyCost((1 << operandBits) - 1, MUL_LOOP, &size, &cycles);
+        if (size * MUL_SIZE_WEIGHT + cycles < bestCost)
+        {
+            best = MUL_LOOP;
+            bestCost = size * MUL_SIZE_WEIGHT + cycles;
+            operandCounts = true;
+        }
+    }
+    debugLog("Depuração: Multiplicação por %d, estratégia %d (custo %d)\n", k, best, bestCost);
+
+    if (best == MUL_LOOP)
+    {
+        emitMultiplyLoop(operand, constOperand(k), operandCounts ? MUL_COUNT_LEFT : MUL_COUNT_RIGHT);
+        return;
+    }
+
+    char mName[64];
+    const char *m = operandName(operand, mName);
+    emitLoad(operand);
+    if (best == MUL_REPEATED_ADD)
+    {
+        for (int i = 1; i < k; i++)
+            fprintf(cc->asmOut, "ADD %s\n", m);
+        return;
+    }
+    char doubled[64];
+    newTemp(doubled);
+    for (int bit = bitLength(k) - 2; bit >= 0; bit--)
+    {
+        fprintf(cc->asmOut, "STA %s\n", doubled);
+        fprintf(cc->asmOut, "ADD %s\n", doubled);
+        if ((k >> bit) & 1)
+            fprintf(cc->asmOut, "ADD %s\n", m);
+    }
+}
+
+/**
+ * emitDivideBySubtraction – divisão por subtrações repetidas
+ * @left: dividendo
+ * @right: divisor
+ *
+ * Gerador antigo, mantido por --div-subtract: código curto, mas executa uma
+ * volta por unidade do quociente (até 255) e trata operandos como com sinal.
+ * O teste de divisor zero é omitido quando o intervalo o exclui.
+ */
+void emitDivideBySubtraction(IrOperand left, IrOperand right)
+{
+    char quotient[64], dividendBuffer[64], divisorBuffer[64];
+    const char *dividend = mutableCopy(left, dividendBuffer);
+    const char *divisor = readOnlyCopy(right, divisorBuffer);
+    newTemp(quotient);
+    ensureConstantExists(0);
+    ensureConstantExists(1);
+
+    int id = cc->labelCounter++;
+    if (operandRange(right).lo == 0)
+    {
+        emitLoad(right);
+        fprintf(cc->asmOut, "JMZ DIV_DONE_%d\n", id);
+    }
+    fprintf(cc->asmOut, "LDA CONST_0\n");
+    fprintf(cc->asmOut, "STA %s\n", quotient);
+    fprintf(cc->asmOut, "DIV_LOOP_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", dividend);
+    fprintf(cc->asmOut, "SUB %s\n", divisor);
+    fprintf(cc->asmOut, "JMN DIV_END_%d\n", id);
+    fprintf(cc->asmOut, "STA %s\n", dividend);
+    fprintf(cc->asmOut, "LDA %s\n", quotient);
+    fprintf(cc->asmOut, "ADD CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", quotient);
+    fprintf(cc->asmOut, "JMP DIV_LOOP_%d\n", id);
+    fprintf(cc->asmOut, "DIV_END_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", quotient);
+    fprintf(cc->asmOut, "DIV_DONE_%d:\n", id);
+}
+
+/**
+ * emitDivisionLoop – laço da divisão longa: bits voltas sobre o par (r:n)
+ * @bits: algarismos significativos do dividendo (1 a 8)
+ */
+void emitDivisionLoop(const char *n, const char *d, const char *r, const char *count, int bits, int id)
+{
+    fprintf(cc->asmOut, "LDA CONST_0\n");
+    fprintf(cc->asmOut, "STA %s\n", r);
+    if (bits < 8)
+    {
+        /* alinha o bit mais alto possível do dividendo ao bit 7 */
+        fprintf(cc->asmOut, "LDA %s\n", n);
+        for (int shift = bits; shift < 8; shift++)
+        {
+            fprintf(cc->asmOut, "ADD %s\n", n);
+            fprintf(cc->asmOut, "STA %s\n", n);
+        }
+    }
+    fprintf(cc->asmOut, "LDA CONST_%d\n", bits);
+    fprintf(cc->asmOut, "STA %s\n", count);
+
+    fprintf(cc->asmOut, "DIV_LOOP_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", r);
+    fprintf(cc->asmOut, "ADD %s\n", r);
+    fprintf(cc->asmOut, "STA %s\n", r);
+    fprintf(cc->asmOut, "LDA %s\n", n);
+    fprintf(cc->asmOut, "JMN DIV_CARRY_%d\n", id);
+    fprintf(cc->asmOut, "ADD %s\n", n);
+    fprintf(cc->asmOut, "STA %s\n", n);
+    fprintf(cc->asmOut, "JMP DIV_CMP_%d\n", id);
+    fprintf(cc->asmOut, "DIV_CARRY_%d:\n", id);
+    fprintf(cc->asmOut, "ADD %s\n", n);
+    fprintf(cc->asmOut, "STA %s\n", n);
+    fprintf(cc->asmOut, "LDA %s\n", r);
+    fprintf(cc->asmOut, "ADD CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", r);
+    fprintf(cc->asmOut, "DIV_CMP_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", r);
+    fprintf(cc->asmOut, "SUB %s\n", d);
+    fprintf(cc->asmOut, "JMN DIV_NEXT_%d\n", id);
+    fprintf(cc->asmOut, "STA %s\n", r);
+    fprintf(cc->asmOut, "LDA %s\n", n);
+    fprintf(cc->asmOut, "ADD CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", n);
+    fprintf(cc->asmOut, "DIV_NEXT_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", count);
+    fprintf(cc->asmOut, "SUB CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", count);
+    fprintf(cc->asmOut, "JMZ DIV_DONE_%d\n", id);
+    fprintf(cc->asmOut, "JMP DIV_LOOP_%d\n", id);
+}
+
+/**
+ * emitDivideBig – divisor >= 128: quociente 1 se dividendo >= divisor, senão 0
+ */
+void emitDivideBig(const char *n, const char *d, int id)
+{
+    /* quociente 1 só se os dois têm o bit 7 ligado e dividendo - divisor >= 0 */
+    fprintf(cc->asmOut, "DIV_BIG_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", n);
+    fprintf(cc->asmOut, "JMN DIV_BIGCMP_%d\n", id);
+    fprintf(cc->asmOut, "LDA CONST_0\n");
+    fprintf(cc->asmOut, "JMP DIV_END_%d\n", id);
+    fprintf(cc->asmOut, "DIV_BIGCMP_%d:\n", id);
+    fprintf(cc->asmOut, "SUB %s\n", d);
+    fprintf(cc->asmOut, "JMN DIV_BIGZERO_%d\n", id);
+    fprintf(cc->asmOut, "LDA CONST_1\n");
+    fprintf(cc->asmOut, "JMP DIV_END_%d\n", id);
+    fprintf(cc->asmOut, "DIV_BIGZERO_%d:\n", id);
+    fprintf(cc->asmOut, "LDA CONST_0\n");
+    fprintf(cc->asmOut, "JMP DIV_END_%d\n", id);
+}
+
+/**
+ * emitLongDivision – divisão longa binária com restauração, sem sinal
+ * @left: dividendo
+ * @right: divisor
+ *
+ * Desloca o par (resto:dividendo) um bit por volta, durante exatamente 8
+ * voltas; o bit do quociente entra no lugar do bit que saiu do dividendo,
+ * que ao final contém o quociente. Com divisor < 128 o resto dobrado cabe em
+ * 8 bits e resto - divisor fica em (-128, 128), então JMN compara sem sinal.
+ * Divisor >= 128 dá quociente 0 ou 1 e é tratado à parte; divisor zero
+ * desvia direto para o fim com AC = 0.
+ *
+ * Pelos intervalos, omite o teste de zero e o caminho de divisor >= 128
+ * quando o divisor não pode chegar a eles. Um dividendo de no máximo b bits
+ * é deslocado 8 - b bits à esquerda antes do laço, que dá só b voltas: as
+ * voltas sobre os zeros à esquerda não mudariam nada.
+ */
+void emitLongDivision(IrOperand left, IrOperand right)
+{
+    ValueRange divisor = operandRange(right);
+    bool mayBeZero = divisor.lo == 0;
+    bool mayBeBig = divisor.hi >= 128;
+    bool onlyBig = divisor.lo >= 128;
+    int bits = bitLength(operandRange(left).hi);
+    if (bits == 0)
+        bits = 1;
+
+    char nBuffer[64], dBuffer[64], r[64], count[64];
+    const char *n = mutableCopy(left, nBuffer);
+    const char *d = readOnlyCopy(right, dBuffer);
+    newTemp(r);
+    newTemp(count);
+    ensureConstantExists(0);
+    ensureConstantExists(1);
+    if (!onlyBig)
+        ensureConstantExists(bits);
+
+    int id = cc->labelCounter++;
+    if (mayBeZero || (mayBeBig && !onlyBig))
+        emitLoad(right);
+    if (mayBeZero)
+        fprintf(cc->asmOut, "JMZ DIV_END_%d\n", id);
+    if (mayBeBig && !onlyBig)
+        fprintf(cc->asmOut, "JMN DIV_BIG_%d\n", id);
+    if (!onlyBig)
+        emitDivisionLoop(n, d, r, count, bits, id);
+    if (mayBeBig)
+        emitDivideBig(n, d, id);
+    if (!onlyBig)
+    {
+        fprintf(cc->asmOut, "DIV_DONE_%d:\n", id);
+        fprintf(cc->asmOut, "LDA %s\n", n);
+    }
+    fprintf(cc->asmOut, "DIV_END_%d:\n", id);
+    debugLog("Depuração: Divisão: %d voltas%s%s\n", onlyBig ? 0 : bits, mayBeZero ? "" : ", divisor não nulo",
+             mayBeBig ? "" : ", divisor < 128");
+}
+
+/**
+ * emitDivideCode – gera a divisão inteira sem sinal de 8 bits
+ *
+ * Literais são resolvidos em tempo de compilação; divisão por zero resulta
+ * em 0, tanto aqui quanto em tempo de execução.
+ */
+void emitDivideCode(IrOperand left, IrOperand right)
+{
+    if (right.kind == OPND_CONST && right.value == 0)
+    {
+        fprintf(stderr, "Erro: Divisão por zero\n");
+        fprintf(cc->asmOut, "; Erro: Divisão por zero\n");
+        emitLoad(constOperand(0));
+        return;
+    }
+    if (left.kind == OPND_CONST && right.kind == OPND_CONST)
+    {
+        int result = left.value / right.value;
+        emitLoad(constOperand(result));
+        debugLog("Depuração: Divisão %d / %d = %d\n", left.value, right.value, result);
+        return;
+    }
+
+    if (divideBySubtraction)
+        emitDivideBySubtraction(left, right);
+    else
+        emitLongDivision(left, right);
+}
+
+/**
+ * readsTempFromAc – a instrução consome o temporário diretamente do AC?
+ *
+ * Verdadeiro quando a seleção de use começa carregando temp (e só o lê uma
+ * vez): nesse caso o valor recém-calculado não precisa ir para a memória.
+ * O laço de multiplicação e a divisão carregam primeiro o operando esquerdo;
+ * a multiplicação por constante lê o operando várias vezes.
+ */
+bool readsTempFromAc(IrInstr *use, int temp)
+{
+    IrOperand operand = tempOperand(temp);
+    switch (use->op)
+    {
+    case IR_COPY:
+    case IR_STORE:
+    case IR_RESULT:
+        return sameOperand(use->a, operand);
+    case IR_ADD:
+        return sameOperand(use->a, operand) || sameOperand(use->b, operand);
+    case IR_SUB:
+    case IR_DIV:
+        return sameOperand(use->a, operand);
+    case IR_MUL:
+        return sameOperand(use->a, operand) && use->b.kind != OPND_CONST;
+    default:
+        return false;
+    }
+}
+
+/**
+ * planTempHomes – decide quais temporários do IR precisam de um TEMP_
+ *
+ * Um temporário com um único uso, na instrução seguinte e lido do AC, fica
+ * só no acumulador; os demais recebem um TEMP_ virtual, alocado na definição.
+ */
+void planTempHomes()
+{
+    int *uses = cc->irTempUses = arenaAlloc(&cc->astArena, (cc->ir.tempCount + 1) * sizeof(int));
+    cc->tempInAcOnly = arenaAlloc(&cc->astArena, cc->ir.tempCount + 1);
+    cc->irTempHome = arenaAlloc(&cc->astArena, (cc->ir.tempCount + 1) * sizeof(int));
+    for (int t = 0; t < cc->ir.tempCount; t++)
+    {
+        uses[t] = 0;
+        cc->tempInAcOnly[t] = false;
+        cc->irTempHome[t] = -1;
+    }
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        if (cc->ir.code[i].a.kind == OPND_TEMP)
+            uses[cc->ir.code[i].a.value]++;
+        if (cc->ir.code[i].b.kind == OPND_TEMP)
+            uses[cc->ir.code[i].b.value]++;
+    }
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        int t = cc->ir.code[i].dst;
+        if (t < 0 || uses[t] != 1)
+            continue;
+        int next = i + 1;
+        while (next < cc->ir.count && cc->ir.code[next].op == IR_STMT)
+            next++;
+        cc->tempInAcOnly[t] = next < cc->ir.count && readsTempFromAc(&cc->ir.code[next], t);
+    }
+}
+
+/**
+ * finishTemp – o AC contém o valor de temp; guarda-o se precisar de memória
+ * @keepAliases: o AC continua igual aos operandos que já continha (cópia)
+ */
+void finishTemp(int temp, bool keepAliases)
+{
+    if (!keepAliases)
+        acClear();
+    acAdd(tempOperand(temp));
+    if (cc->tempInAcOnly[temp])
+        return;
+    cc->irTempHome[temp] = cc->tempCount;
+    char home[64];
+    newTemp(home);
+    fprintf(cc->asmOut, "STA %s\n", home);
+}
+
+/**
+ * selectInstructions – seletor único: traduz o IR para assembly Neander
+ */
+void selectInstructions()
+{
+    planTempHomes();
+    acClear();
+    char a[64], b[64];
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        IrInstr *instr = &cc->ir.code[i];
+        switch (instr->op)
+        {
+        case IR_STMT:
+            if (instr->var >= 0)
+                fprintf(cc->asmOut, "; Atribuição: %s = ...\n", cc->varTable[instr->var].name);
+            else
+                fprintf(cc->asmOut, "; Expressão final do resultado\n");
+            break;
+        case IR_COPY:
+            emitLoad(instr->a);
+            finishTemp(instr->dst, true);
+            break;
+        case IR_ADD:
+            /* comutativa: soma o operando que não está no AC */
+            if (!acHas(instr->a) && acHas(instr->b))
+            {
+                emitLoad(instr->b);
+                fprintf(cc->asmOut, "ADD %s\n", operandName(instr->a, a));
+            }
+            else
+            {
+                emitLoad(instr->a);
+                fprintf(cc->asmOut, "ADD %s\n", operandName(instr->b, b));
+            }
+            finishTemp(instr->dst, false);
+            break;
+        case IR_SUB:
+            emitLoad(instr->a);
+            fprintf(cc->asmOut, "SUB %s\n", operandName(instr->b, b));
+            finishTemp(instr->dst, false);
+            break;
+        case IR_MUL:
+            emitMultiplyCode(instr->a, instr->b);
+            finishTemp(instr->dst, false);
+            break;
+        case IR_DIV:
+            emitDivideCode(instr->a, instr->b);
+            finishTemp(instr->dst, false);
+            break;
+        case IR_STORE:
+            emitLoad(instr->a);
+            fprintf(cc->asmOut, "STA %s\n", cc->varTable[instr->var].name);
+            declareSymbol(instr->var);
+            acAdd(varOperand(instr->var));
+            updateVarRange(instr);
+            break;
+        case IR_RESULT:
+            emitLoad(instr->a);
+            fprintf(cc->asmOut, "STA RES\n");
+            fprintf(cc->asmOut, "HLT\n");
+            break;
+        case IR_NOP:
+            break;
+        }
+    }
+}
+
+/**
+ * WideName – nomes das duas palavras de um valor de 16 bits (--int16)
+ *
+ * Passado sempre por ponteiro: lo e hi podem apontar para os buffers.
+ */
+typedef struct
+{
+    const char *lo;
+    const char *hi;
+    char loBuffer[64];
+    char hiBuffer[64];
+} WideName;
+
+/**
+ * highSymbol – id de <nome>.HI, a palavra alta da variável ou de RES
+ *
+ * O ponto não é aceito pelo lexer em identificadores, então o nome não
+ * colide com variáveis do programa.
+ */
+int highSymbol(int id)
+{
+    if (cc->varTable[id].high < 0)
+    {
+        char name[64];
+        int len = snprintf(name, sizeof(name), "%s.HI", cc->varTable[id].name);
+        /* internSymbol pode realocar varTable */
+        int high = internSymbol(name, len);
+        cc->varTable[id].high = high;
+    }
+    return cc->varTable[id].high;
+}
+
+/**
+ * wideOperandName – nomes das palavras baixa e alta do operando
+ *
+ * Constantes usam o pool CONST_ de 8 bits, uma entrada por byte; o
+ * temporário ocupa dois TEMP_ virtuais consecutivos.
+ */
+void wideOperandName(IrOperand operand, WideName *name)
+{
+    switch (operand.kind)
+    {
+    case OPND_CONST:
+    {
+        int lo = ensureConstantExists(operand.value & 0xFF);
+        int hi = ensureConstantExists(operand.value >> 8);
+        name->lo = cc->varTable[lo].name;
+        name->hi = cc->varTable[hi].name;
+        break;
+    }
+    case OPND_VAR:
+    {
+        int hi = highSymbol(operand.value);
+        declareSymbol(operand.value);
+        declareSymbol(hi);
+        name->lo = cc->varTable[operand.value].name;
+        name->hi = cc->varTable[hi].name;
+        break;
+    }
+    case OPND_TEMP:
+        if (cc->irTempHome[operand.value] < 0)
+        {
+            fprintf(stderr, "Erro interno: t%d lido da memória sem ter sido guardado\n", operand.value);
+            failCompilation();
+        }
+        sprintf(name->loBuffer, "TEMP_%d", cc->irTempHome[operand.value]);
+        sprintf(name->hiBuffer, "TEMP_%d", cc->irTempHome[operand.value] + 1);
+        name->lo = name->loBuffer;
+        name->hi = name->hiBuffer;
+        break;
+    default:
+        name->lo = name->hi = "?";
+        break;
+    }
+}
+
+/**
+ * newWideTemp – par de TEMP_ virtuais para um valor de 16 bits
+ * @temp: temporário do IR que o par guarda, ou -1 para um auxiliar
+ */
+void newWideTemp(int temp, WideName *name)
+{
+    if (temp >= 0)
+        cc->irTempHome[temp] = cc->tempCount;
+    newTemp(name->loBuffer);
+    newTemp(name->hiBuffer);
+    name->lo = name->loBuffer;
+    name->hi = name->hiBuffer;
+}
+
+/**
+ * emitWideCopy – copia as duas palavras de a para r
+ */
+void emitWideCopy(const WideName *a, const WideName *r)
+{
+    fprintf(cc->asmOut, "LDA %s\n", a->lo);
+    fprintf(cc->asmOut, "STA %s\n", r->lo);
+    fprintf(cc->asmOut, "LDA %s\n", a->hi);
+    fprintf(cc->asmOut, "STA %s\n", r->hi);
+}
+
+/**
+ * emitWideAdd – r = a + b em 16 bits, com vai-um da palavra baixa para a alta
+ *
+ * O Neander não tem flag de carry; o vai-um sai dos bits 7 dos operandos
+ * (testados com JMN) e da soma: os dois ligados sempre geram vai-um, só um
+ * ligado gera vai-um quando a soma tem o bit 7 desligado. A palavra alta é
+ * somada primeiro, então r pode ser o próprio a ou b.
+ */
+void emitWideAdd(const WideName *a, const WideName *b, const WideName *r)
+{
+    ensureConstantExists(1);
+    int id = cc->labelCounter++;
+    fprintf(cc->asmOut, "LDA %s\n", a->hi);
+    fprintf(cc->asmOut, "ADD %s\n", b->hi);
+    fprintf(cc->asmOut, "STA %s\n", r->hi);
+    fprintf(cc->asmOut, "LDA %s\n", a->lo);
+    fprintf(cc->asmOut, "JMN WADD_AN_%d\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", b->lo);
+    fprintf(cc->asmOut, "JMN WADD_MIX_%d\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", a->lo);
+    fprintf(cc->asmOut, "ADD %s\n", b->lo);
+    fprintf(cc->asmOut, "STA %s\n", r->lo);
+    fprintf(cc->asmOut, "JMP WADD_END_%d\n", id);
+    fprintf(cc->asmOut, "WADD_AN_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", b->lo);
+    fprintf(cc->asmOut, "JMN WADD_BOTH_%d\n", id);
+    fprintf(cc->asmOut, "WADD_MIX_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", a->lo);
+    fprintf(cc->asmOut, "ADD %s\n", b->lo);
+    fprintf(cc->asmOut, "STA %s\n", r->lo);
+    fprintf(cc->asmOut, "JMN WADD_END_%d\n", id);
+    fprintf(cc->asmOut, "JMP WADD_CARRY_%d\n", id);
+    fprintf(cc->asmOut, "WADD_BOTH_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", a->lo);
+    fprintf(cc->asmOut, "ADD %s\n", b->lo);
+    fprintf(cc->asmOut, "STA %s\n", r->lo);
+    fprintf(cc->asmOut, "WADD_CARRY_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", r->hi);
+    fprintf(cc->asmOut, "ADD CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", r->hi);
+    fprintf(cc->asmOut, "WADD_END_%d:\n", id);
+}
+
+/**
+ * emitWideSub – r = a - b em 16 bits, com empréstimo da palavra alta
+ *
+ * Há empréstimo quando a.lo < b.lo sem sinal: bit 7 de a desligado e o de
+ * b ligado sempre empresta, o contrário nunca; bits iguais emprestam quando
+ * a diferença fica negativa. r pode ser o próprio a ou b.
+ */
+void emitWideSub(const WideName *a, const WideName *b, const WideName *r)
+{
+    ensureConstantExists(1);
+    int id = cc->labelCounter++;
+    fprintf(cc->asmOut, "LDA %s\n", a->hi);
+    fprintf(cc->asmOut, "SUB %s\n", b->hi);
+    fprintf(cc->asmOut, "STA %s\n", r->hi);
+    fprintf(cc->asmOut, "LDA %s\n", a->lo);
+    fprintf(cc->asmOut, "JMN WSUB_AN_%d\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", b->lo);
+    fprintf(cc->asmOut, "JMN WSUB_LESS_%d\n", id);
+    fprintf(cc->asmOut, "JMP WSUB_SAME_%d\n", id);
+    fprintf(cc->asmOut, "WSUB_AN_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", b->lo);
+    fprintf(cc->asmOut, "JMN WSUB_SAME_%d\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", a->lo);
+    fprintf(cc->asmOut, "SUB %s\n", b->lo);
+    fprintf(cc->asmOut, "STA %s\n", r->lo);
+    fprintf(cc->asmOut, "JMP WSUB_END_%d\n", id);
+    fprintf(cc->asmOut, "WSUB_SAME_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", a->lo);
+    fprintf(cc->asmOut, "SUB %s\n", b->lo);
+    fprintf(cc->asmOut, "STA %s\n", r->lo);
+    fprintf(cc->asmOut, "JMN WSUB_BORROW_%d\n", id);
+    fprintf(cc->asmOut, "JMP WSUB_END_%d\n", id);
+    fprintf(cc->asmOut, "WSUB_LESS_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", a->lo);
+    fprintf(cc->asmOut, "SUB %s\n", b->lo);
+    fprintf(cc->asmOut, "STA %s\n", r->lo);
+    fprintf(cc->asmOut, "WSUB_BORROW_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", r->hi);
+    fprintf(cc->asmOut, "SUB CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", r->hi);
+    fprintf(cc->asmOut, "WSUB_END_%d:\n", id);
+}
+
+/**
+ * emitWideAlign – desloca x à esquerda até que um valor de bits bits chegue ao bit 15
+ *
+ * Oito bits de uma vez movem a palavra baixa para a alta; o resto dobra x.
+ */
+void emitWideAlign(const WideName *x, int bits)
+{
+    int shift = 16 - bits;
+    if (shift >= 8)
+    {
+        ensureConstantExists(0);
+        fprintf(cc->asmOut, "LDA %s\n", x->lo);
+        fprintf(cc->asmOut, "STA %s\n", x->hi);
+        fprintf(cc->asmOut, "LDA CONST_0\n");
+        fprintf(cc->asmOut, "STA %s\n", x->lo);
+        shift -= 8;
+    }
+    for (; shift > 0; shift--)
+        emitWideAdd(x, x, x);
+}
+
+/* desdobra a multiplicação por constante até este número de somas de 16 bits */
+#define WIDE_MUL_UNROLL_ADDS 6
+
+/**
+ * emitWideMultiply – r = a * b em 16 bits
+ *
+ * Com um fator constante k barato, desdobra o esquema de Horner (dobra r e
+ * soma o outro fator a cada bit ligado de k). Senão, laço que percorre o
+ * multiplicador do bit mais alto ao 0: r = 2r, mais o outro fator se o bit
+ * saindo do multiplicador estiver ligado. O multiplicador é o operando
+ * cujo intervalo tem menos bits; com b bits, ele é alinhado ao bit 15 antes
+ * do laço, que dá só b voltas.
+ */
+void emitWideMultiply(IrOperand left, IrOperand right, const WideName *r)
+{
+    WideName a, b;
+    wideOperandName(left, &a);
+    wideOperandName(right, &b);
+
+    int k = right.kind == OPND_CONST ? right.value : left.kind == OPND_CONST ? left.value : -1;
+    const WideName *m = right.kind == OPND_CONST ? &a : &b;
+    if (k >= 0 && bitLength(k) + popCount(k) - 2 <= WIDE_MUL_UNROLL_ADDS)
+    {
+        debugLog("Depuração: Multiplicação de 16 bits por %d, desdobrada\n", k);
+        if (k == 0)
+        {
+            WideName zero;
+            wideOperandName(constOperand(0), &zero);
+            emitWideCopy(&zero, r);
+            return;
+        }
+        emitWideCopy(m, r);
+        for (int bit = bitLength(k) - 2; bit >= 0; bit--)
+        {
+            emitWideAdd(r, r, r);
+            if ((k >> bit) & 1)
+                emitWideAdd(r, m, r);
+        }
+        return;
+    }
+
+    int leftBits = bitLength(operandRange(left).hi);
+    int bits = bitLength(operandRange(right).hi);
+    const WideName *factor = &a, *source = &b;
+    if (leftBits < bits)
+    {
+        factor = &b;
+        source = &a;
+        bits = leftBits;
+    }
+    if (bits == 0)
+        bits = 1;
+    debugLog("Depuração: Multiplicação de 16 bits: %d voltas\n", bits);
+
+    WideName multiplier;
+    char count[64];
+    newWideTemp(-1, &multiplier);
+    newTemp(count);
+    ensureConstantExists(0);
+    ensureConstantExists(1);
+    ensureConstantExists(bits);
+
+    int id = cc->labelCounter++;
+    emitWideCopy(source, &multiplier);
+    emitWideAlign(&multiplier, bits);
+    fprintf(cc->asmOut, "LDA CONST_0\n");
+    fprintf(cc->asmOut, "STA %s\n", r->lo);
+    fprintf(cc->asmOut, "STA %s\n", r->hi);
+    fprintf(cc->asmOut, "LDA CONST_%d\n", bits);
+    fprintf(cc->asmOut, "STA %s\n", count);
+    fprintf(cc->asmOut, "WMUL_LOOP_%d:\n", id);
+    emitWideAdd(r, r, r);
+    fprintf(cc->asmOut, "LDA %s\n", multiplier.hi);
+    fprintf(cc->asmOut, "JMN WMUL_ADD_%d\n", id);
+    fprintf(cc->asmOut, "JMP WMUL_NEXT_%d\n", id);
+    fprintf(cc->asmOut, "WMUL_ADD_%d:\n", id);
+    emitWideAdd(r, factor, r);
+    fprintf(cc->asmOut, "WMUL_NEXT_%d:\n", id);
+    emitWideAdd(&multiplier, &multiplier, &multiplier);
+    fprintf(cc->asmOut, "LDA %s\n", count);
+    fprintf(cc->asmOut, "SUB CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", count);
+    fprintf(cc->asmOut, "JMZ WMUL_END_%d\n", id);
+    fprintf(cc->asmOut, "JMP WMUL_LOOP_%d\n", id);
+    fprintf(cc->asmOut, "WMUL_END_%d:\n", id);
+}
+
+/**
+ * emitWideDivide – r = a / b em 16 bits, sem sinal, divisão longa com restauração
+ *
+ * Como emitLongDivision, mas com o par (resto:quociente) de 32 bits e 16
+ * voltas. O bit que sai do resto ao dobrá-lo é guardado antes; se estava
+ * ligado, o resto passa de 16 bits e com certeza é >= b. A comparação
+ * resto >= b é sem sinal, palavra alta primeiro. Divisor zero dá 0, e o
+ * teste é omitido quando o intervalo do divisor exclui o zero. Um dividendo
+ * de no máximo b bits é alinhado ao bit 15 e o laço dá só b voltas.
+ */
+void emitWideDivide(IrOperand left, IrOperand right, const WideName *r)
+{
+    bool mayBeZero = operandRange(right).lo == 0;
+    int bits = bitLength(operandRange(left).hi);
+    if (bits == 0)
+        bits = 1;
+    debugLog("Depuração: Divisão de 16 bits: %d voltas%s\n", bits, mayBeZero ? "" : ", divisor não nulo");
+
+    WideName a, b, rest;
+    wideOperandName(left, &a);
+    wideOperandName(right, &b);
+    newWideTemp(-1, &rest);
+    char top[64], count[64];
+    newTemp(top);
+    newTemp(count);
+    ensureConstantExists(0);
+    ensureConstantExists(1);
+    ensureConstantExists(bits);
+
+    int id = cc->labelCounter++;
+    char next[32], subtract[32];
+    sprintf(next, "WDIV_NEXT_%d", id);
+    sprintf(subtract, "WDIV_SUB_%d", id);
+
+    if (mayBeZero)
+    {
+        fprintf(cc->asmOut, "LDA %s\n", b.lo);
+        fprintf(cc->asmOut, "OR %s\n", b.hi);
+        fprintf(cc->asmOut, "JMZ WDIV_ZERO_%d\n", id);
+    }
+    emitWideCopy(&a, r);
+    emitWideAlign(r, bits);
+    fprintf(cc->asmOut, "LDA CONST_0\n");
+    fprintf(cc->asmOut, "STA %s\n", rest.lo);
+    fprintf(cc->asmOut, "STA %s\n", rest.hi);
+    fprintf(cc->asmOut, "LDA CONST_%d\n", bits);
+    fprintf(cc->asmOut, "STA %s\n", count);
+
+    fprintf(cc->asmOut, "WDIV_LOOP_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", rest.hi);
+    fprintf(cc->asmOut, "STA %s\n", top);
+    emitWideAdd(&rest, &rest, &rest);
+    fprintf(cc->asmOut, "LDA %s\n", r->hi);
+    fprintf(cc->asmOut, "JMN WDIV_BITIN_%d\n", id);
+    fprintf(cc->asmOut, "JMP WDIV_SHIFT_%d\n", id);
+    fprintf(cc->asmOut, "WDIV_BITIN_%d:\n", id);
+    fprintf(cc->asmOut, "LDA %s\n", rest.lo);
+    fprintf(cc->asmOut, "ADD CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", rest.lo);
+    fprintf(cc->asmOut, "WDIV_SHIFT_%d:\n", id);
+    emitWideAdd(r, r, r);
+    fprintf(cc->asmOut, "LDA %s\n", top);
+    fprintf(cc->asmOut, "JMN %s\n", subtract);
+    fprintf(cc->asmOut, "LDA %s\n", rest.hi);
+    fprintf(cc->asmOut, "SUB %s\n", b.hi);
+    fprintf(cc->asmOut, "JMZ WDIV_LOW_%d\n", id);
+    emitUnsignedBelow(rest.hi, b.hi, next, subtract);
+    fprintf(cc->asmOut, "WDIV_LOW_%d:\n", id);
+    emitUnsignedBelow(rest.lo, b.lo, next, subtract);
+    fprintf(cc->asmOut, "%s:\n", subtract);
+    emitWideSub(&rest, &b, &rest);
+    fprintf(cc->asmOut, "LDA %s\n", r->lo);
+    fprintf(cc->asmOut, "ADD CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", r->lo);
+    fprintf(cc->asmOut, "%s:\n", next);
+    fprintf(cc->asmOut, "LDA %s\n", count);
+    fprintf(cc->asmOut, "SUB CONST_1\n");
+    fprintf(cc->asmOut, "STA %s\n", count);
+    fprintf(cc->asmOut, "JMZ WDIV_END_%d\n", id);
+    fprintf(cc->asmOut, "JMP WDIV_LOOP_%d\n", id);
+
+    if (mayBeZero)
+    {
+        fprintf(cc->asmOut, "WDIV_ZERO_%d:\n", id);
+        fprintf(cc->asmOut, "LDA CONST_0\n");
+        fprintf(cc->asmOut, "STA %s\n", r->lo);
+        fprintf(cc->asmOut, "STA %s\n", r->hi);
+    }
+    fprintf(cc->asmOut, "WDIV_END_%d:\n", id);
+}
+
+/**
+ * selectWideInstructions – seletor de --int16: traduz o IR para assembly Neander
+ *
+ * Cada valor ocupa duas palavras (baixa e alta), então não há cache do
+ * acumulador: todo temporário do IR recebe um par de TEMP_ na definição.
+ * RES.HI segue RES no .DATA e é gravado antes dele.
+ */
+void selectWideInstructions()
+{
+    cc->irTempHome = arenaAlloc(&cc->astArena, (cc->ir.tempCount + 1) * sizeof(int));
+    for (int t = 0; t < cc->ir.tempCount; t++)
+        cc->irTempHome[t] = -1;
+    WideName a, b, r;
+    for (int i = 0; i < cc->ir.count; i++)
+    {
+        IrInstr *instr = &cc->ir.code[i];
+        switch (instr->op)
+        {
+        case IR_STMT:
+            if (instr->var >= 0)
+                fprintf(cc->asmOut, "; Atribuição: %s = ...\n", cc->varTable[instr->var].name);
+            else
+                fprintf(cc->asmOut, "; Expressão final do resultado\n");
+            break;
+        case IR_COPY:
+            wideOperandName(instr->a, &a);
+            newWideTemp(instr->dst, &r);
+            emitWideCopy(&a, &r);
+            break;
+        case IR_ADD:
+        case IR_SUB:
+            wideOperandName(instr->a, &a);
+            wideOperandName(instr->b, &b);
+            newWideTemp(instr->dst, &r);
+            if (instr->op == IR_ADD)
+                emitWideAdd(&a, &b, &r);
+            else
+                emitWideSub(&a, &b, &r);
+            break;
+        case IR_MUL:
+            newWideTemp(instr->dst, &r);
+            emitWideMultiply(instr->a, instr->b, &r);
+            break;
+        case IR_DIV:
+            newWideTemp(instr->dst, &r);
+            emitWideDivide(instr->a, instr->b, &r);
+            break;
+        case IR_STORE:
+            wideOperandName(instr->a, &a);
+            wideOperandName(varOperand(instr->var), &r);
+            emitWideCopy(&a, &r);
+            updateVarRange(instr);
+            break;
+        case IR_RESULT:
+            wideOperandName(instr->a, &a);
+            fprintf(cc->asmOut, "LDA %s\n", a.hi);
+            fprintf(cc->asmOut, "STA RES.HI\n");
+            fprintf(cc->asmOut, "LDA %s\n", a.lo);
+            fprintf(cc->asmOut, "STA RES\n");
+            fprintf(cc->asmOut, "HLT\n");
+            break;
+        case IR_NOP:
+            break;
+        }
+    }
+}
+
+/**
+ * TempInterval – intervalo de vida de um TEMP_ virtual no código gerado
+ */
+typedef struct TempInterval
+{
+    int start; /* primeira linha que o menciona, -1 se nunca usado */
+    int end;   /* última linha que o menciona */
+    int slot;  /* TEMP_ físico atribuído */
+} TempInterval;
+
+/**
+ * instructionOperand – operando de uma linha de código gerado
+ * @line: início da linha
+ * @len: tamanho da linha, sem o '\n'
+ * @opLen: recebe o tamanho do operando
+ * @return: início do operando, ou NULL para rótulos, comentários e HLT
+ */
+const char *instructionOperand(const char *line, size_t len, size_t *opLen)
+{
+    if (len == 0 || line[0] == ';' || line[len - 1] == ':')
+        return NULL;
+    const char *space = memchr(line, ' ', len);
+    if (!space || space == line)
+        return NULL;
+    *opLen = len - (size_t)(space + 1 - line);
+    return space + 1;
+}
+
+/**
+ * tempNumber – número do TEMP_ virtual nomeado pelo operando, ou -1
+ */
+int tempNumber(const char *operand, size_t len)
+{
+    if (len <= 5 || strncmp(operand, "TEMP_", 5) != 0)
+        return -1;
+    int number = 0;
+    for (size_t i = 5; i < len; i++)
+    {
+        if (!isdigit((unsigned char)operand[i]))
+            return -1;
+        number = number * 10 + (operand[i] - '0');
+    }
+    return number < cc->tempCount ? number : -1;
+}
+
+/**
+ * allocateTemps – reaproveita TEMP_ cujos intervalos de vida não se sobrepõem
+ * @code: código gerado, uma instrução ou rótulo por linha
+ * @size: tamanho do código
+ *
+ * O código é linear exceto pelos laços de multiplicação e divisão. O
+ * intervalo de cada temporário vai da primeira à última linha que o
+ * menciona; um intervalo que cruza um laço (desvio para trás) é estendido
+ * ao laço inteiro, pois o valor precisa sobreviver à volta. Laços que se
+ * sobrepõem formam uma única região, então basta estender cada ponta do
+ * intervalo até a borda da região em que ela cai. Em seguida, uma varredura
+ * linear em ordem de início atribui os slots físicos.
+ */
+void allocateTemps(const char *code, size_t size)
+{
+    cc->tempIntervals = arenaAlloc(&cc->astArena, (cc->tempCount + 1) * sizeof(TempInterval));
+    for (int i = 0; i < cc->tempCount; i++)
+    {
+        cc->tempIntervals[i].start = -1;
+        cc->tempIntervals[i].end = -1;
+        cc->tempIntervals[i].slot = -1;
+    }
+
+    /* rótulos e desvios: posições em linhas; loopReach[l] é o fim do laço mais longo que começa em l */
+    int lineCount = 0;
+    for (size_t i = 0; i < size; i++)
+        lineCount += code[i] == '\n';
+    int *loopReach = arenaAlloc(&cc->astArena, (lineCount + 1) * sizeof(int));
+    for (int l = 0; l <= lineCount; l++)
+        loopReach[l] = -1;
+    int *labelLine = NULL; /* linha de cada rótulo, indexada pelo símbolo */
+    int labelLineCount = 0;
+
+    int lineNo = 0;
+    for (const char *line = code; line < code + size; lineNo++)
+    {
+        const char *eol = memchr(line, '\n', code + size - line);
+        size_t len = eol ? (size_t)(eol - line) : (size_t)(code + size - line);
+        size_t opLen;
+        const char *operand = instructionOperand(line, len, &opLen);
+        if (len > 1 && line[0] != ';' && line[len - 1] == ':')
+        {
+            int id = internSymbol(line, len - 1);
+            if (id >= labelLineCount)
+            {
+                int count = cc->varCapacity;
+                labelLine = realloc(labelLine, count * sizeof(int));
+                if (!labelLine)
+                {
+                    perror("Erro ao alocar memória");
+                    failCompilation();
+                }
+                for (int i = labelLineCount; i < count; i++)
+                    labelLine[i] = -1;
+                labelLineCount = count;
+            }
+            labelLine[id] = lineNo;
+        }
+        else if (operand)
+        {
+            int temp = tempNumber(operand, opLen);
+            if (temp >= 0)
+            {
+                if (cc->tempIntervals[temp].start < 0)
+                    cc->tempIntervals[temp].start = lineNo;
+                cc->tempIntervals[temp].end = lineNo;
+            }
+            else if (line[0] == 'J')
+            {
+                /* só rótulos já vistos: desvio para trás */
+                int id = findSymbol(operand, opLen);
+                int target = id >= 0 && id < labelLineCount ? labelLine[id] : -1;
+                if (target >= 0 && loopReach[target] < lineNo)
+                    loopReach[target] = lineNo;
+            }
+        }
+        line += len + 1;
+    }
+    free(labelLine);
+
+    /* regiões: regionStart/regionEnd[l] delimitam a união de laços sobrepostos que contém l */
+    int *regionStart = arenaAlloc(&cc->astArena, (lineCount + 1) * sizeof(int));
+    int *regionEnd = arenaAlloc(&cc->astArena, (lineCount + 1) * sizeof(int));
+    for (int l = 0, start = 0, end = -1; l <= lineCount; l++)
+    {
+        if (l > end)
+        {
+            start = l;
+            end = loopReach[l];
+        }
+        else if (loopReach[l] > end)
+        {
+            end = loopReach[l];
+        }
+        regionStart[l] = l <= end ? start : l;
+    }
+    for (int l = lineCount, end = lineCount; l >= 0; l--)
+    {
+        if (l == lineCount || regionStart[l + 1] != regionStart[l])
+            end = l;
+        regionEnd[l] = end;
+    }
+    for (int i = 0; i < cc->tempCount; i++)
+    {
+        TempInterval *interval = &cc->tempIntervals[i];
+        if (interval->start < 0)
+            continue;
+        interval->start = regionStart[interval->start];
+        interval->end = regionEnd[interval->end];
+    }
+
+    /* varredura linear: slotEnd[s] é o fim do intervalo que ocupa o slot s */
+    int *order = arenaAlloc(&cc->astArena, (cc->tempCount + 1) * sizeof(int));
+    int *slotEnd = arenaAlloc(&cc->astArena, (cc->tempCount + 1) * sizeof(int));
+    int *startCount = arenaAlloc(&cc->astArena, (lineCount + 2) * sizeof(int));
+    memset(startCount, 0, (lineCount + 2) * sizeof(int));
+    for (int i = 0; i < cc->tempCount; i++)
+    {
+        if (cc->tempIntervals[i].start >= 0)
+            startCount[cc->tempIntervals[i].start + 1]++;
+    }
+    for (int l = 0; l <= lineCount; l++)
+        startCount[l + 1] += startCount[l];
+    int used = startCount[lineCount + 1];
+    for (int i = 0; i < cc->tempCount; i++)
+    {
+        if (cc->tempIntervals[i].start >= 0)
+            order[startCount[cc->tempIntervals[i].start]++] = i;
+    }
+    cc->tempSlotCount = 0;
+    for (int k = 0; k < used; k++)
+    {
+        TempInterval *interval = &cc->tempIntervals[order[k]];
+        int slot = 0;
+        while (slot < cc->tempSlotCount && slotEnd[slot] >= interval->start)
+            slot++;
+        if (slot == cc->tempSlotCount)
+            cc->tempSlotCount++;
+        slotEnd[slot] = interval->end;
+        interval->slot = slot;
+    }
+    debugLog("Depuração: Temporários: %d virtuais, %d slots após análise de vida\n", cc->tempCount, cc->tempSlotCount);
+}
+
+/**
+ * writeCode – copia o código gerado trocando cada TEMP_ virtual pelo seu slot
+ */
+void writeCode(const char *code, size_t size)
+{
+    for (const char *line = code; line < code + size;)
+    {
+        const char *eol = memchr(line, '\n', code + size - line);
+        size_t len = eol ? (size_t)(eol - line) : (size_t)(code + size - line);
+        size_t opLen;
+        const char *operand = instructionOperand(line, len, &opLen);
+        int temp = operand ? tempNumber(operand, opLen) : -1;
+        if (temp >= 0)
+            fprintf(cc->asmOut, "%.*sTEMP_%d\n", (int)(operand - line), line, cc->tempIntervals[temp].slot);
+        else
+            fprintf(cc->asmOut, "%.*s\n", (int)len, line);
+        line += len + 1;
+    }
+}
+
+/**
+ * generateCode – seleciona as instruções em memória e aloca os temporários
+ *
+ * O código é gerado antes de qualquer saída para que o .DATA declare todas
+ * as constantes e temporários criados durante a geração.
+ */
+void generateCode()
+{
+    cc->asmOut = open_memstream(&cc->codeText, &cc->codeSize);
+    if (!cc->asmOut)
+    {
+        perror("Erro ao alocar memória");
+        failCompilation();
+    }
+    if (wideIntegers)
+        selectWideInstructions();
+    else
+        selectInstructions();
+    fclose(cc->asmOut);
+    cc->asmOut = NULL;
+    allocateTemps(cc->codeText, cc->codeSize);
+}
+
+/**
+ * emitAssemblyCode – grava o código gerado como texto assembly em asmOut
+ */
+void emitAssemblyCode()
+{
+    fprintf(cc->asmOut, "; %s\n\n", cc->program.name);
+
+    /* só RES é fixo; constantes entram na tabela quando o código as usa */
+    fprintf(cc->asmOut, ".DATA\n");
+    fprintf(cc->asmOut, "RES DB ?\n");
+    if (wideIntegers)
+        fprintf(cc->asmOut, "RES.HI DB ?\n");
+
+    for (int i = 0; i < cc->dataSymbolCount; i++)
+    {
+        Var *var = &cc->varTable[cc->dataSymbols[i]];
+        if (var->defined)
+            fprintf(cc->asmOut, "%s DB %d\n", var->name, var->value);
+        else
+            fprintf(cc->asmOut, "%s DB ?\n", var->name);
+    }
+
+    for (int i = 0; i < cc->tempSlotCount; i++)
+        fprintf(cc->asmOut, "TEMP_%d DB ?\n", i);
+
+    fprintf(cc->asmOut, "\n.CODE\n");
+    fprintf(cc->asmOut, ".ORG 0\n");
+    writeCode(cc->codeText, cc->codeSize);
+
+    debugLog("Depuração: Código assembly gerado com sucesso!\n");
+}
+
+/**
+ * NeanderOpcode – códigos de operação do Neander (byte baixo da palavra)
+ */
+typedef enum
+{
+    OP_NOP = 0x00,
+    OP_STA = 0x10,
+    OP_LDA = 0x20,
+    OP_ADD = 0x30,
+    OP_SUB = 0x31,
+    OP_OR = 0x40,
+    OP_AND = 0x50,
+    OP_NOT = 0x60,
+    OP_JMP = 0x80,
+    OP_JMN = 0x90,
+    OP_JMZ = 0xA0,
+    OP_HLT = 0xF0
+} NeanderOpcode;
+
+/**
+ * Mnemonic – código de operação de uma instrução Neander
+ */
+typedef struct
+{
+    const char *name;
+    uint8_t opcode;
+    bool hasOperand;
+} Mnemonic;
+
+static const Mnemonic mnemonics[] = {
+    {"NOP", OP_NOP, false}, {"STA", OP_STA, true}, {"LDA", OP_LDA, true}, {"ADD", OP_ADD, true},
+    {"SUB", OP_SUB, true},  {"OR", OP_OR, true},   {"AND", OP_AND, true}, {"NOT", OP_NOT, false},
+    {"JMP", OP_JMP, true},  {"JMN", OP_JMN, true}, {"JMZ", OP_JMZ, true}, {"HLT", OP_HLT, false},
+};
+
+/**
+ * findMnemonic – instrução cujo nome é o início da linha, ou NULL
+ */
+const Mnemonic *findMnemonic(const char *line, size_t len)
+{
+    const char *space = memchr(line, ' ', len);
+    size_t nameLen = space ? (size_t)(space - line) : len;
+    for (size_t i = 0; i < sizeof(mnemonics) / sizeof(mnemonics[0]); i++)
+    {
+        if (strlen(mnemonics[i].name) == nameLen && strncmp(mnemonics[i].name, line, nameLen) == 0)
+            return &mnemonics[i];
+    }
+    return NULL;
+}
+
+/**
+ * CodeLabel – rótulo do código gerado e a palavra em que ele cai
+ */
+typedef struct
+{
+    int symbol;
+    int word;
+} CodeLabel;
+
+/**
+ * assembleImage – monta o código gerado na memória, no layout do executor
+ * @memory: memória zerada, com MEMORYSIZE bytes (legado) ou WIDEMEMORYSIZE (estendido)
+ * @wide: operandos de 16 bits e dados logo após o código se ele passar de DATAWORD
+ * @quiet: não informa quando o programa não cabe (o oráculo tenta de novo no layout estendido)
+ * @layout: recebe os segmentos
+ *
+ * Mesmo layout do montador para o .asm equivalente: código a partir da
+ * palavra 0 e dados a partir de DATAWORD na ordem do .DATA (RES, variáveis
+ * e constantes, slots TEMP_). Os rótulos entram na tabela de símbolos numa
+ * primeira passada sobre as linhas; cada operando é então resolvido por uma
+ * consulta ao índice hash, sem comparar nomes um a um.
+ *
+ * @return: true se sucesso, false se o programa não cabe na imagem
+ */
+bool assembleImage(uint8_t *memory, bool wide, bool quiet, ImageLayout *layout)
+{
+    /* primeira passada: posição de cada rótulo */
+    int lineCount = 0;
+    for (size_t i = 0; i < cc->codeSize; i++)
+        lineCount += cc->codeText[i] == '\n';
+    CodeLabel *labels = arenaAlloc(&cc->astArena, (lineCount + 1) * sizeof(CodeLabel));
+    int labelCount = 0;
+    int codeWords = 0;
+    for (const char *line = cc->codeText; line < cc->codeText + cc->codeSize;)
+    {
+        const char *eol = memchr(line, '\n', cc->codeText + cc->codeSize - line);
+        size_t len = eol ? (size_t)(eol - line) : (size_t)(cc->codeText + cc->codeSize - line);
+        if (len > 1 && line[0] != ';' && line[len - 1] == ':')
+        {
+            labels[labelCount].symbol = internSymbol(line, len - 1);
+            labels[labelCount++].word = codeWords;
+        }
+        else if (len > 0 && line[0] != ';')
+        {
+            codeWords += 2;
+        }
+        line += len + 1;
     }
-    printf("Depuração: Encontrado INICIO\n");
-
-    while (1)
+    if (codeWords > DATAWORD && !wide)
     {
-        t = peekLexToken();
-        if (!t)
-            break;
-        if (t->type == TOKEN_RES)
-            break;
-        parseAssignment();
+        if (quiet)
+            return false;
+        fprintf(stderr, "Erro: código ocupa %d palavras e invade a área de dados (limite %d)\n", codeWords, DATAWORD);
+        return false;
     }
 
-    t = getLexToken();
-    if (!t || t->type != TOKEN_RES)
+    /* dados: RES (e RES.HI, com --int16) em dataBase, depois os símbolos na ordem do .DATA */
+    int dataBase = codeWords > DATAWORD ? codeWords : DATAWORD;
+    int wordLimit = wide ? WIDEWORDS : (LEGACYIMAGESIZE - HEADERSIZE) / 2;
+    int fixedWords = wideIntegers ? 2 : 1;
+    int dataCount = fixedWords + cc->dataSymbolCount;
+    int dataWords = dataCount + cc->tempSlotCount;
+    if (dataBase + dataWords > wordLimit)
     {
-        printf("Erro: esperado RES\n");
-        exit(1);
+        if (quiet)
+            return false;
+        fprintf(stderr, "Erro: %d palavras de dados excedem a imagem (limite %d)\n", dataWords, wordLimit - dataBase);
+        return false;
     }
-    printf("Depuração: Encontrado RES\n");
+    int result = internSymbol("RES", 3);
+    int resultHigh = wideIntegers ? internSymbol("RES.HI", 6) : -1;
 
-    t = getLexToken();
-    if (!t || t->type != TOKEN_EQ)
+    /* symbolWord[id]: palavra do rótulo ou do dado; rótulos têm precedência */
+    int *symbolWord = arenaAlloc(&cc->astArena, cc->varCount * sizeof(int));
+    for (int id = 0; id < cc->varCount; id++)
+        symbolWord[id] = -1;
+    for (int l = 0; l < labelCount; l++)
+        symbolWord[labels[l].symbol] = labels[l].word;
+    if (symbolWord[result] < 0)
+        symbolWord[result] = dataBase;
+    if (resultHigh >= 0 && symbolWord[resultHigh] < 0)
+        symbolWord[resultHigh] = dataBase + 1;
+    for (int k = 0; k < cc->dataSymbolCount; k++)
     {
-        printf("Erro: esperado '=' após RES\n");
-        exit(1);
+        int id = cc->dataSymbols[k];
+        if (symbolWord[id] < 0)
+            symbolWord[id] = dataBase + fixedWords + k;
+        if (cc->varTable[id].defined)
+            memory[HEADERSIZE + 2 * (dataBase + fixedWords + k)] = (uint8_t)cc->varTable[id].value;
     }
-    program.resultExpr = parseExpr();
-    printf("Depuração: Expressão final (resultado) lida\n");
+    int tempBase = dataBase + dataCount;
 
-    t = getLexToken();
-    if (!t || t->type != TOKEN_END)
+    /* segunda passada: codificação, 4 bytes por instrução */
+    uint8_t *pos = memory + HEADERSIZE;
+    for (const char *line = cc->codeText; line < cc->codeText + cc->codeSize;)
     {
-        printf("Erro: esperado FIM\n");
-        exit(1);
+        const char *eol = memchr(line, '\n', cc->codeText + cc->codeSize - line);
+        size_t len = eol ? (size_t)(eol - line) : (size_t)(cc->codeText + cc->codeSize - line);
+        const char *next = line + len + 1;
+        if (len == 0 || line[0] == ';' || line[len - 1] == ':')
+        {
+            line = next;
+            continue;
+        }
+        const Mnemonic *mnemonic = findMnemonic(line, len);
+        if (!mnemonic)
+        {
+            fprintf(stderr, "Erro interno: instrução desconhecida '%.*s'\n", (int)len, line);
+            return false;
+        }
+        int word = 0;
+        size_t opLen;
+        const char *operand = mnemonic->hasOperand ? instructionOperand(line, len, &opLen) : NULL;
+        if (operand)
+        {
+            word = -1;
+            int temp = tempNumber(operand, opLen);
+            if (temp >= 0)
+                word = tempBase + cc->tempIntervals[temp].slot;
+            int id = word < 0 ? findSymbol(operand, opLen) : -1;
+            if (id >= 0)
+                word = symbolWord[id];
+            if (word < 0)
+            {
+                fprintf(stderr, "Erro interno: símbolo '%.*s' sem endereço\n", (int)opLen, operand);
+                return false;
+            }
+        }
+        pos[0] = mnemonic->opcode;
+        pos[2] = (uint8_t)word;
+        pos[3] = wide ? (uint8_t)(word >> 8) : 0;
+        pos += 4;
+        line = next;
     }
-    printf("Depuração: Encontrado FIM\n");
+
+    memset(layout, 0, sizeof(*layout));
+    layout->flags = wide ? COMPACTFLAGWIDE : 0;
+    layout->codeWords = (uint16_t)codeWords;
+    layout->dataBase = (uint16_t)dataBase;
+    layout->dataWords = (uint16_t)dataWords;
+    return true;
 }
 
 /**
- * Var – representa entry na tabela de variáveis/constantes
+ * writeBinaryImage – monta o código gerado direto na imagem 0x03 'NDR'
+ * @path: arquivo .bin de saída
+ *
+ * Com --int16 o código não cabe no PC de 8 bits: grava a imagem compacta
+ * estendida, com os símbolos RES e RES.HI para o executor.
+ *
+ * @return: true se sucesso
  */
-typedef struct
+bool writeBinaryImage(const char *path)
 {
-    char name[64];
-    int value;
-    bool defined;
-} Var;
+    uint8_t *memory = calloc(wideIntegers ? WIDEMEMORYSIZE : MEMORYSIZE, 1);
+    if (!memory)
+    {
+        perror("Erro ao alocar memória");
+        return false;
+    }
+    ImageLayout layout;
+    bool written;
+    if (wideIntegers)
+    {
+        ImageSymbol symbols[2] = {{"RES", 0}, {"RES.HI", 0}};
+        written = assembleImage(memory, true, false, &layout);
+        symbols[0].address = layout.dataBase;
+        symbols[1].address = layout.dataBase + 1;
+        layout.flags |= COMPACTFLAGSYMBOLS;
+        layout.symbols = symbols;
+        layout.symbolCount = 2;
+        written = written && write_compact_image(path, memory, &layout);
+    }
+    else
+    {
+        written = assembleImage(memory, false, false, &layout) && write_legacy_image(path, memory);
+    }
+    free(memory);
+    if (written)
+        debugLog("Depuração: Imagem gravada: código %d palavras, dados %d palavras\n", layout.codeWords,
+                 layout.dataWords);
+    return written;
+}
 
-#define MAX_VARS 256
-Var varTable[MAX_VARS];
-int varCount = 0;
+#define ORACLE_STEP_LIMIT 10000000
 
 /**
- * addVar – adiciona símbolo se não existir
+ * checkWithPipeline – oráculo: compara o RES de --eval com o do código gerado
+ * @expected: resultado do bytecode
+ *
+ * O código já gerado (IR, passes, seleção, alocação de temporários) é
+ * montado na mesma imagem que o montador produziria e executado até HLT por
+ * run_neander, o laço do próprio executor. Sem --int16 a imagem é a legada,
+ * com PC de 8 bits e 256 palavras; um programa que não cabe nela é
+ * verificado no layout estendido, como ficaria com assembler --extended.
+ *
+ * @return: true se os resultados coincidem
  */
-int addVar(const char *name)
+bool checkWithPipeline(int expected)
 {
-    for (int i = 0; i < varCount; i++)
+    uint8_t *memory = calloc(WIDEMEMORYSIZE, 1);
+    if (!memory)
+    {
+        perror("Erro ao alocar memória");
+        return false;
+    }
+    ImageLayout layout;
+    bool wide = wideIntegers || !assembleImage(memory, false, true, &layout);
+    bool ok = true;
+    if (wide)
     {
-        if (strcmp(varTable[i].name, name) == 0)
-            return i;
+        if (!wideIntegers && !batchMode)
+            printf("Oráculo: o programa não cabe na imagem legada; verificado no layout estendido\n");
+        memset(memory, 0, WIDEMEMORYSIZE);
+        ok = assembleImage(memory, true, false, &layout);
     }
-    strncpy(varTable[varCount].name, name, sizeof(varTable[varCount].name) - 1);
-    varTable[varCount].name[sizeof(varTable[varCount].name) - 1] = '\0';
-    varTable[varCount].value = 0;
-    varTable[varCount].defined = false;
-    varCount++;
-    printf("Depuração: Símbolo adicionado -> %s\n", name);
-    return varCount - 1;
+    NeanderState state = {0, 0, 0};
+    if (ok && !run_neander(memory, wide ? WIDEMEMORYSIZE : MEMORYSIZE, wide, &state, ORACLE_STEP_LIMIT))
+    {
+        fprintf(stderr, "Erro: oráculo: o código gerado não parou em %d instruções\n", ORACLE_STEP_LIMIT);
+        ok = false;
+    }
+    if (ok)
+    {
+        int actual = memory[HEADERSIZE + 2 * layout.dataBase];
+        if (wideIntegers)
+            actual |= memory[HEADERSIZE + 2 * (layout.dataBase + 1)] << 8;
+        if (actual != expected)
+        {
+            int digits = wideIntegers ? 4 : 2;
+            fprintf(stderr, "Erro: oráculo: --eval deu 0x%0*X = %d, o código gerado deu 0x%0*X = %d\n", digits,
+                    expected, signedValue(expected), digits, actual, signedValue(actual));
+            ok = false;
+        }
+        else if (!batchMode)
+        {
+            printf("Oráculo: código gerado confere (%lu instruções executadas)\n", state.executed);
+        }
+    }
+    free(memory);
+    return ok;
 }
 
 /**
- * updateVarValue – define valor de variável existente
+ * failCompilation – abandona a compilação corrente
+ *
+ * Volta a compileFile, que libera o estado da compilação; no modo em lote
+ * as demais compilações continuam.
  */
-void updateVarValue(const char *name, int value)
+void failCompilation()
 {
-    for (int i = 0; i < varCount; i++)
+    if (!cc)
+        exit(1);
+    longjmp(cc->failure, 1);
+}
+
+/**
+ * hashTokenStream – chave do cache: hash dos tokens normalizados e das opções
+ * @fp: arquivo .lpn, devolvido ao início
+ *
+ * Os tokens já descartam espaços, quebras de linha e caracteres ignorados
+ * pelo lexer; números entram sem zeros à esquerda. A chave inclui o nível
+ * de -O, --div-subtract, --int16 e a data de compilação do próprio
+ * compilador, para que um compilador novo não reaproveite código gerado
+ * pelo antigo.
+ */
+uint64_t hashTokenStream(FILE *fp)
+{
+    const char *build = __DATE__ " " __TIME__;
+    uint8_t options[3] = {(uint8_t)optimizationLevel, divideBySubtraction, wideIntegers};
+    uint64_t hash = fnvHash(14695981039346656037ull, build, strlen(build));
+    hash = fnvHash(hash, options, sizeof(options));
+
+    cc->hashingTokens = true;
+    openLexer(fp);
+    LexToken *t;
+    while ((t = getLexToken()) && t->type != TOKEN_EOF)
     {
-        if (strcmp(varTable[i].name, name) == 0)
+        const char *lexeme = t->lexeme;
+        if (t->type == TOKEN_NUM)
         {
-            varTable[i].value = value;
-            varTable[i].defined = true;
-            printf("Depuração: Atualizado %s com valor %d\n", name, value);
-            return;
+            while (lexeme[0] == '0' && lexeme[1])
+                lexeme++;
         }
+        uint8_t type = (uint8_t)t->type;
+        hash = fnvHash(hash, &type, 1);
+        hash = fnvHash(hash, lexeme, strlen(lexeme) + 1);
     }
-    addVar(name);
-    updateVarValue(name, value);
+    cc->hashingTokens = false;
+    rewind(fp);
+    return hash;
 }
 
+#define LEX_BENCH_ROUNDS 5
+
 /**
- * ensureConstantExists – garante que CONST_<value> esteja na tabela
+ * benchmarkLexer – mede só o lexer sobre o arquivo inteiro (--lex-bench)
+ * @fp: arquivo .lpn, relido a cada rodada
+ *
+ * Cada rodada reabre o lexer e consome todos os tokens, sem o parser e sem
+ * saída de depuração; vale a melhor de LEX_BENCH_ROUNDS, para descontar a
+ * primeira leitura do arquivo.
  */
-void ensureConstantExists(int value)
+void benchmarkLexer(FILE *fp)
 {
-    char constName[64];
-    sprintf(constName, "CONST_%d", value);
-    for (int i = 0; i < varCount; i++)
+    fseek(fp, 0, SEEK_END);
+    long bytes = ftell(fp);
+    rewind(fp);
+    double best = 0;
+    int tokens = 0;
+    cc->hashingTokens = true;
+    for (int round = 0; round < LEX_BENCH_ROUNDS; round++)
     {
-        if (strcmp(varTable[i].name, constName) == 0)
-            return;
+        double start = nowSeconds();
+        openLexer(fp);
+        LexToken *t;
+        while ((t = getLexToken()) && t->type != TOKEN_EOF)
+            ;
+        double seconds = nowSeconds() - start;
+        if (round == 0 || seconds < best)
+            best = seconds;
+        tokens = cc->tokenCount;
+        rewind(fp);
     }
-    addVar(constName);
-    updateVarValue(constName, value);
+    cc->hashingTokens = false;
+    printf("Léxico: %d tokens em %.2f MB, melhor de %d rodadas: %.3f ms, %.1f MB/s\n", tokens, bytes / 1e6,
+           LEX_BENCH_ROUNDS, best * 1e3, best > 0 ? bytes / 1e6 / best : 0.0);
 }
 
-int tempCount = 0;
-char tempBuffer[64];
-
 /**
- * newTemp – gera nome TEMP_<n> para operação intermediária
+ * copyFile – copia o arquivo from para to
+ * @publish: grava num temporário ao lado de to e o renomeia, para que
+ *           leitores e escritores concorrentes nunca vejam uma cópia parcial
+ *
+ * @return: true se sucesso
  */
-void newTemp(char *buffer)
+bool copyFile(const char *from, const char *to, bool publish)
 {
-    sprintf(buffer, "TEMP_%d", tempCount++);
-    addVar(buffer);
+    FILE *in = fopen(from, "rb");
+    if (!in)
+        return false;
+    char tempPath[512];
+    FILE *out;
+    if (publish)
+    {
+        snprintf(tempPath, sizeof(tempPath), "%s.XXXXXX", to);
+        int fd = mkstemp(tempPath);
+        out = fd >= 0 ? fdopen(fd, "wb") : NULL;
+        if (fd >= 0 && !out)
+            close(fd);
+    }
+    else
+    {
+        out = fopen(to, "wb");
+    }
+    if (!out)
+    {
+        fclose(in);
+        return false;
+    }
+
+    char buffer[8192];
+    size_t n;
+    bool ok = true;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        ok = ok && fwrite(buffer, 1, n, out) == n;
+    ok = !ferror(in) && ok;
+    fclose(in);
+    ok = fclose(out) == 0 && ok;
+    if (publish)
+    {
+        ok = ok && rename(tempPath, to) == 0;
+        if (!ok)
+            unlink(tempPath);
+    }
+    return ok;
 }
 
-FILE *asmOut;
+/**
+ * cachePath – caminho da entrada do cache com a chave e a extensão
+ */
+void cachePath(char *buffer, size_t size, uint64_t key, const char *extension)
+{
+    snprintf(buffer, size, "%s/%016llx%s", cacheDir, (unsigned long long)key, extension);
+}
 
 /**
- * emitExprCode – gera instruções assembly para expr_node_t
+ * runCompilation – lê, otimiza e gera o código de um arquivo .lpn
+ * @inputFile: programa de entrada; as saídas usam o mesmo nome com .asm e .bin
+ *
+ * @return: true se sucesso
  */
-void emitExprCode(ExprNode *node)
+bool runCompilation(const char *inputFile)
 {
-    if (node->type == EXPR_NUM)
+    cc->inputFile = inputFile;
+    cc->input = fopen(inputFile, "r");
+    if (!cc->input)
     {
-        char constName[64];
-        sprintf(constName, "CONST_%d", node->num);
-        ensureConstantExists(node->num);
-        fprintf(asmOut, "LDA %s\n", constName);
-        printf("Depuração: Gerado código: LDA %s  [valor %d]\n", constName, node->num);
+        perror("Erro ao abrir o arquivo .lpn");
+        return false;
     }
-    else if (node->type == EXPR_VAR)
+    if (lexBenchmark)
     {
-        addVar(node->var);
-        fprintf(asmOut, "LDA %s\n", node->var);
-        printf("Depuração: Gerado código: LDA %s\n", node->var);
+        benchmarkLexer(cc->input);
+        return true;
     }
-    else if (node->type == EXPR_BINOP)
+
+    char outputFile[256], binaryFile[256];
+    strncpy(outputFile, inputFile, sizeof(outputFile) - 5);
+    outputFile[sizeof(outputFile) - 5] = '\0';
+    char *dot = strrchr(outputFile, '.');
+    if (dot)
+        *dot = '\0';
+    strcpy(binaryFile, outputFile);
+    strcat(outputFile, ".asm");
+    strcat(binaryFile, ".bin");
+
+    /* cache: uma entrada serve se tiver todas as saídas pedidas */
+    uint64_t cacheKey = 0;
+    char cachedAsm[512], cachedBin[512];
+    bool useCache = cacheDir && evalMode == EVAL_OFF;
+    if (useCache)
     {
-        char op = node->binop.op;
-        /* Soma */
-        if (op == '+')
+        beginPhase("hashTokenStream");
+        cacheKey = hashTokenStream(cc->input);
+        endPhase();
+        cachePath(cachedAsm, sizeof(cachedAsm), cacheKey, ".asm");
+        cachePath(cachedBin, sizeof(cachedBin), cacheKey, ".bin");
+        if ((!emitAssembly || copyFile(cachedAsm, outputFile, false)) &&
+            (!emitBinary || copyFile(cachedBin, binaryFile, false)))
         {
-            if (node->binop.left->type == EXPR_VAR && node->binop.right->type == EXPR_VAR)
-            {
-
-                fprintf(asmOut, "LDA %s\n", node->binop.left->var);
-                fprintf(asmOut, "ADD %s\n", node->binop.right->var);
-            }
-            else if (node->binop.left->type == EXPR_VAR && node->binop.right->type == EXPR_NUM)
-            {
+            atomic_fetch_add(&cacheHits, 1);
+            if (!batchMode)
+                printf("\nCompilação concluída com sucesso (cache %016llx): %s\n", (unsigned long long)cacheKey,
+                       emitAssembly ? outputFile : binaryFile);
+            return true;
+        }
+        atomic_fetch_add(&cacheMisses, 1);
+    }
 
-                char constName[64];
-                sprintf(constName, "CONST_%d", node->binop.right->num);
-                ensureConstantExists(node->binop.right->num);
-                fprintf(asmOut, "LDA %s\n", node->binop.left->var);
-                fprintf(asmOut, "ADD %s\n", constName);
-            }
-            else if (node->binop.left->type == EXPR_NUM && node->binop.right->type == EXPR_VAR)
-            {
+    if (emitAssembly)
+    {
+        cc->asmFile = fopen(outputFile, "w");
+        if (!cc->asmFile)
+        {
+            perror("Erro ao criar arquivo de saída .asm");
+            return false;
+        }
+    }
 
-                char constName[64];
-                sprintf(constName, "CONST_%d", node->binop.left->num);
-                ensureConstantExists(node->binop.left->num);
-                fprintf(asmOut, "LDA %s\n", constName);
-                fprintf(asmOut, "ADD %s\n", node->binop.right->var);
-            }
-            else if (node->binop.left->type == EXPR_NUM && node->binop.right->type == EXPR_NUM)
-            {
+    /* o parser puxa os tokens sob demanda; o arquivo é lido em blocos */
+    debugLog("LexTokens Gerados (sob demanda)\n\n");
+    openLexer(cc->input);
 
-                int result = node->binop.left->num + node->binop.right->num;
-                char constName[64];
-                sprintf(constName, "CONST_%d", result);
-                ensureConstantExists(result);
-                fprintf(asmOut, "LDA %s\n", constName);
-            }
-            else
-            {
-                emitExprCode(node->binop.left);
-                if (node->binop.right->type == EXPR_VAR)
-                {
-                    fprintf(asmOut, "ADD %s\n", node->binop.right->var);
-                }
-                else if (node->binop.right->type == EXPR_NUM)
-                {
-                    char constName[64];
-                    sprintf(constName, "CONST_%d", node->binop.right->num);
-                    ensureConstantExists(node->binop.right->num);
-                    fprintf(asmOut, "ADD %s\n", constName);
-                }
-                else
-                {
-                    newTemp(tempBuffer);
-                    fprintf(asmOut, "STA %s\n", tempBuffer);
+    beginPhase("parseCompilationUnit");
+    parseCompilationUnit();
+    endPhase();
+    debugLog("\nTotal de LexTokens: %d\n\n", cc->tokenCount);
+    closeLexer();
+    fclose(cc->input);
+    cc->input = NULL;
 
-                    emitExprCode(node->binop.right);
+    int evalResult = 0;
+    if (evalMode != EVAL_OFF)
+    {
+        beginPhase("evaluateProgram");
+        evalResult = evaluateProgram();
+        endPhase();
+        if (!batchMode)
+            printf("Resultado: 0x%0*X = %d\n", wideIntegers ? 4 : 2, evalResult, signedValue(evalResult));
+    }
+    if (evalMode == EVAL_ONLY)
+        return true;
 
-                    fprintf(asmOut, "ADD %s\n", tempBuffer);
-                }
-            }
-            /* Subtração */
-        }
-        else if (op == '-')
-        {
-            if (node->binop.left->type == EXPR_VAR && node->binop.right->type == EXPR_VAR)
-            {
+    beginPhase("lowerProgram");
+    lowerProgram();
+    endPhase();
+    beginPhase("runPasses");
+    runPasses();
+    endPhase();
 
-                fprintf(asmOut, "LDA %s\n", node->binop.left->var);
-                fprintf(asmOut, "SUB %s\n", node->binop.right->var);
-            }
-            else if (node->binop.left->type == EXPR_VAR && node->binop.right->type == EXPR_NUM)
-            {
+    beginPhase("generateCode");
+    generateCode();
+    endPhase();
+    if (cc->asmFile)
+    {
+        cc->asmOut = cc->asmFile;
+        beginPhase("emitAssemblyCode");
+        emitAssemblyCode();
+        fclose(cc->asmFile);
+        endPhase();
+        cc->asmFile = NULL;
+        cc->asmOut = NULL;
+    }
+    if (emitBinary)
+    {
+        beginPhase("writeBinaryImage");
+        bool written = writeBinaryImage(binaryFile);
+        endPhase();
+        if (!written)
+            return false;
+    }
+    if (evalMode == EVAL_CHECK && !checkWithPipeline(evalResult))
+    {
+        fprintf(stderr, "Erro: oráculo falhou em %s\n", inputFile);
+        return false;
+    }
+    if (useCache && ((emitAssembly && !copyFile(outputFile, cachedAsm, true)) ||
+                     (emitBinary && !copyFile(binaryFile, cachedBin, true))))
+        printf("Aviso: não foi possível gravar %s no cache\n", inputFile);
 
-                char constName[64];
-                sprintf(constName, "CONST_%d", node->binop.right->num);
-                ensureConstantExists(node->binop.right->num);
-                fprintf(asmOut, "LDA %s\n", node->binop.left->var);
-                fprintf(asmOut, "SUB %s\n", constName);
-            }
-            else if (node->binop.left->type == EXPR_NUM && node->binop.right->type == EXPR_VAR)
-            {
+    if (!batchMode)
+    {
+        printf("\nCompilação concluída com sucesso: %s\n", emitAssembly ? outputFile : binaryFile);
+        if (emitAssembly && emitBinary)
+            printf("Binário gravado: %s\n", binaryFile);
+        printf("Temporários: %d gerados, pico de %d vivos\n", cc->tempCount, cc->tempSlotCount);
+    }
+    return true;
+}
 
-                char constName[64];
-                sprintf(constName, "CONST_%d", node->binop.left->num);
-                ensureConstantExists(node->binop.left->num);
-                fprintf(asmOut, "LDA %s\n", constName);
-                fprintf(asmOut, "SUB %s\n", node->binop.right->var);
-            }
-            else if (node->binop.left->type == EXPR_NUM && node->binop.right->type == EXPR_NUM)
-            {
+/**
+ * printTimeReport – imprime o --time-report da compilação corrente
+ *
+ * Em texto, uma linha por fase e os tamanhos das estruturas; com
+ * --time-report=json, um único objeto JSON numa linha.
+ */
+void printTimeReport(const char *inputFile)
+{
+    size_t lexerBytes = sizeof(LexSource) + cc->currentLexToken.capacity + cc->lookaheadToken.capacity;
+    size_t symbolBytes = cc->varCapacity * (sizeof(Var) + sizeof(int)) + cc->symbolIndexSize * sizeof(int);
+    size_t astBytes = cc->exprs.count * (3 + 2 * sizeof(uint32_t)) + cc->stmtCount * sizeof(codeLine);
+    double total = 0;
+    for (int i = 0; i < cc->phaseCount; i++)
+        total += cc->phases[i].seconds;
 
-                int result = node->binop.left->num - node->binop.right->num;
-                char constName[64];
-                sprintf(constName, "CONST_%d", result);
-                ensureConstantExists(result);
-                fprintf(asmOut, "LDA %s\n", constName);
-            }
-            else
-            {
-                emitExprCode(node->binop.left);
-                if (node->binop.right->type == EXPR_VAR)
-                {
-                    fprintf(asmOut, "SUB %s\n", node->binop.right->var);
-                }
-                else if (node->binop.right->type == EXPR_NUM)
-                {
-                    char constName[64];
-                    sprintf(constName, "CONST_%d", node->binop.right->num);
-                    ensureConstantExists(node->binop.right->num);
-                    fprintf(asmOut, "SUB %s\n", constName);
-                }
-                else
-                {
-                    newTemp(tempBuffer);
-                    fprintf(asmOut, "STA %s\n", tempBuffer);
-                    emitExprCode(node->binop.right);
-                    char rightTemp[64];
-                    newTemp(rightTemp);
-                    fprintf(asmOut, "STA %s\n", rightTemp);
-                    fprintf(asmOut, "LDA %s\n", tempBuffer);
-                    fprintf(asmOut, "SUB %s\n", rightTemp);
-                }
-            }
-            /* Multiplicação via soma repetida */
-        }
-        else if (op == '*')
+    if (timeReportJson)
+    {
+        printf("{\"file\":\"");
+        for (const char *c = inputFile; *c; c++)
+            printf(*c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+        printf("\",\"totalSeconds\":%.6f,\"lexSeconds\":%.6f,\"debugSeconds\":%.6f,\"phases\":[", total,
+               cc->lexSeconds, cc->debugSeconds);
+        for (int i = 0; i < cc->phaseCount; i++)
         {
-            char tempResult[64];
-            newTemp(tempResult);
-            fprintf(asmOut, "LDA CONST_0\n");
-            fprintf(asmOut, "STA %s\n", tempResult);
-
-            if (node->binop.right->type == EXPR_NUM)
-            {
-                int multiplier = node->binop.right->num;
-                for (int i = 0; i < multiplier; i++)
-                {
-                    emitExprCode(node->binop.left);
-                    fprintf(asmOut, "ADD %s\n", tempResult);
-                    fprintf(asmOut, "STA %s\n", tempResult);
-                }
-            }
-            else if (node->binop.right->type == EXPR_VAR)
-            {
-                int multiplier = -1;
-                for (int i = 0; i < varCount; i++)
-                {
-                    if (strcmp(varTable[i].name, node->binop.right->var) == 0 && varTable[i].defined)
-                    {
-                        multiplier = varTable[i].value;
-                        break;
-                    }
-                }
-                if (multiplier >= 0)
-                {
-                    printf("Depuração: Variável %s tem valor conhecido: %d\n", node->binop.right->var, multiplier);
-                    for (int i = 0; i < multiplier; i++)
-                    {
-                        emitExprCode(node->binop.left);
-                        fprintf(asmOut, "ADD %s\n", tempResult);
-                        fprintf(asmOut, "STA %s\n", tempResult);
-                    }
-                }
-                else
-                {
-                    fprintf(asmOut, "LDA CONST_0\n");
-                    printf("Aviso: Multiplicação com valor desconhecido de %s\n", node->binop.right->var);
-                }
-            }
-            fprintf(asmOut, "LDA %s\n", tempResult);
-            /* Divisão por subtrações repetidas */
+            PhaseReport *phase = &cc->phases[i];
+            printf("%s{\"name\":\"%s\",\"seconds\":%.6f,\"debugSeconds\":%.6f,\"allocations\":%zu,"
+                   "\"arenaBytes\":%zu,\"heapBytes\":%ld,\"peakRssKb\":%ld}",
+                   i ? "," : "", phase->name, phase->seconds, phase->debugSeconds, phase->allocations,
+                   phase->arenaBytes, phase->heapBytes, phase->peakRssKb);
         }
-        else if (op == '/')
-        {
-            if (node->binop.left->type == EXPR_NUM && node->binop.right->type == EXPR_NUM)
-            {
-                if (node->binop.right->num == 0)
-                {
-                    fprintf(stderr, "Erro: Divisão por zero\n");
-                    fprintf(asmOut, "; Erro: Divisão por zero\n");
-                    fprintf(asmOut, "LDA CONST_0\n");
-                    return;
-                }
-                int result = node->binop.left->num / node->binop.right->num;
-                char constName[64];
-                sprintf(constName, "CONST_%d", result);
-                ensureConstantExists(result);
-                fprintf(asmOut, "LDA %s\n", constName);
-                printf("Depuração: Divisão %d / %d = %d\n", node->binop.left->num, node->binop.right->num, result);
-            }
-            else
-            {
-                char quotient[64], dividend[64], divisor[64];
-                newTemp(quotient);
-                newTemp(dividend);
-                newTemp(divisor);
-
-                fprintf(asmOut, "LDA CONST_0\n");
-                fprintf(asmOut, "STA %s\n", quotient);
-
-                if (node->binop.left->type == EXPR_NUM)
-                {
-                    char constName[64];
-                    sprintf(constName, "CONST_%d", node->binop.left->num);
-                    ensureConstantExists(node->binop.left->num);
-                    fprintf(asmOut, "LDA %s\n", constName);
-                }
-                else if (node->binop.left->type == EXPR_VAR)
-                {
-                    fprintf(asmOut, "LDA %s\n", node->binop.left->var);
-                }
-                else
-                {
-                    emitExprCode(node->binop.left);
-                }
-                fprintf(asmOut, "STA %s\n", dividend);
+        printf("],\"sizes\":{\"tokens\":%d,\"lexerBytes\":%zu,\"exprNodes\":%d,\"statements\":%d,"
+               "\"astBytes\":%zu,\"arenaBytes\":%zu,\"arenaBlocks\":%zu,\"vars\":%d,\"varTableBytes\":%zu,"
+               "\"irInstructions\":%d,\"irBytes\":%zu,\"codeBytes\":%zu}}\n",
+               cc->tokenCount, lexerBytes, (int)cc->exprs.count, cc->stmtCount, astBytes, cc->astArena.bytesUsed,
+               cc->astArena.blockCount, cc->varCount, symbolBytes, cc->ir.count,
+               cc->ir.capacity * sizeof(IrInstr), cc->codeSize);
+        return;
+    }
 
-                if (node->binop.right->type == EXPR_NUM)
-                {
-                    if (node->binop.right->num == 0)
-                    {
-                        fprintf(stderr, "Erro: Divisão por zero\n");
-                        fprintf(asmOut, "; Erro: Divisão por zero\n");
-                        fprintf(asmOut, "LDA CONST_0\n");
-                        return;
-                    }
-                    char constName[64];
-                    sprintf(constName, "CONST_%d", node->binop.right->num);
-                    ensureConstantExists(node->binop.right->num);
-                    fprintf(asmOut, "LDA %s\n", constName);
-                }
-                else if (node->binop.right->type == EXPR_VAR)
-                {
-                    fprintf(asmOut, "LDA %s\n", node->binop.right->var);
-                }
-                else
-                {
-                    emitExprCode(node->binop.right);
-                }
-                fprintf(asmOut, "STA %s\n", divisor);
-
-                ensureConstantExists(1);
-
-                static int divLabelCounter = 0;
-                char divLoopLabel[64], divDoneLabel[64];
-                sprintf(divLoopLabel, "DIV_LOOP_%d", divLabelCounter);
-                sprintf(divDoneLabel, "DIV_DONE_%d", divLabelCounter++);
-
-                fprintf(asmOut, "%s:\n", divLoopLabel);
-                fprintf(asmOut, "LDA %s\n", dividend);
-                fprintf(asmOut, "SUB %s\n", divisor);
-                fprintf(asmOut, "JMN %s\n", divDoneLabel);
-                fprintf(asmOut, "STA %s\n", dividend);
-                fprintf(asmOut, "LDA %s\n", quotient);
-                fprintf(asmOut, "ADD CONST_1\n");
-                fprintf(asmOut, "STA %s\n", quotient);
-                fprintf(asmOut, "JMP %s\n", divLoopLabel);
-                fprintf(asmOut, "%s:\n", divDoneLabel);
-                fprintf(asmOut, "LDA %s\n", quotient);
-            }
-        }
+    printf("\nRelatório de tempo: %s\n", inputFile);
+    printf("%-22s %10s %10s %8s %10s %10s %10s\n", "fase", "ms", "debugLog", "alocs", "arena", "heap",
+           "pico RSS");
+    for (int i = 0; i < cc->phaseCount; i++)
+    {
+        PhaseReport *phase = &cc->phases[i];
+        printf("%-22s %10.3f %10.3f %8zu %10zu %10ld %7ld KB\n", phase->name, phase->seconds * 1e3,
+               phase->debugSeconds * 1e3, phase->allocations, phase->arenaBytes, phase->heapBytes,
+               phase->peakRssKb);
     }
+    printf("%-22s %10.3f %10.3f\n", "total", total * 1e3, cc->debugSeconds * 1e3);
+    printf("Léxico (dentro de parseCompilationUnit): %.3f ms\n", cc->lexSeconds * 1e3);
+    printf("Tokens: %d (%zu bytes de lexer)\n", cc->tokenCount, lexerBytes);
+    printf("AST: %d nós, %d atribuições, %zu bytes (arena: %zu bytes em %zu blocos)\n", (int)cc->exprs.count,
+           cc->stmtCount, astBytes, cc->astArena.bytesUsed, cc->astArena.blockCount);
+    printf("varTable: %d de %d entradas, %zu bytes com o índice hash\n", cc->varCount, cc->varCapacity, symbolBytes);
+    printf("IR: %d instruções (%zu bytes reservados); código gerado: %zu bytes\n", cc->ir.count,
+           cc->ir.capacity * sizeof(IrInstr), cc->codeSize);
 }
 
 /**
- * emitAssignmentCode – gera instruções para atribuição
+ * compileFile – compila um arquivo num contexto próprio
+ *
+ * @return: true se sucesso
  */
-void emitAssignmentCode(codeLine *stmt)
+bool compileFile(const char *inputFile)
 {
-    if (stmt->expr && stmt->expr->type == EXPR_NUM)
+    Compilation *compilation = calloc(1, sizeof(Compilation));
+    if (!compilation)
     {
-        updateVarValue(stmt->var, stmt->expr->num);
-        char constName[64];
-        sprintf(constName, "CONST_%d", stmt->expr->num);
-        ensureConstantExists(stmt->expr->num);
-        fprintf(asmOut, "LDA %s\n", constName);
-        fprintf(asmOut, "STA %s\n", stmt->var);
-        printf("Depuração: Gerado código para atribuição direta: %s = %d\n", stmt->var, stmt->expr->num);
-    }
-    else
-    {
-        emitExprCode(stmt->expr);
-        addVar(stmt->var);
-        fprintf(asmOut, "STA %s\n", stmt->var);
-        printf("Depuração: Gerado código para atribuição: %s = <expressão>\n", stmt->var);
+        perror("Erro ao alocar memória");
+        return false;
     }
+    cc = compilation;
+    bool ok = false;
+    if (setjmp(cc->failure) == 0)
+        ok = runCompilation(inputFile);
+    if (ok && timeReport && !batchMode)
+        printTimeReport(inputFile);
+
+    if (cc->input)
+        fclose(cc->input);
+    if (cc->asmOut && cc->asmOut != cc->asmFile)
+        fclose(cc->asmOut);
+    if (cc->asmFile)
+        fclose(cc->asmFile);
+    closeLexer();
+    free(cc->codeText);
+    free(cc->ir.code);
+    free(cc->exprs.type);
+    free(cc->exprs.op);
+    free(cc->exprs.need);
+    free(cc->exprs.left);
+    free(cc->exprs.right);
+    free(cc->varTable);
+    free(cc->symbolIndex);
+    free(cc->dataSymbols);
+    arenaRelease(&cc->astArena);
+    free(compilation);
+    cc = NULL;
+    return ok;
 }
 
-void emitAssemblyCode()
+/**
+ * BatchQueue – arquivos do modo em lote; cada thread pega o próximo índice livre
+ */
+typedef struct
 {
-    fprintf(asmOut, "; %s\n\n", program.name);
-
-    fprintf(asmOut, ".DATA\n");
-    fprintf(asmOut, "ONE DB 1\n");
-    fprintf(asmOut, "CONST_0 DB 0\n");
-    fprintf(asmOut, "CONST_1 DB 1\n");
-    fprintf(asmOut, "NEG_1 DB 255\n");
-    fprintf(asmOut, "RES DB ?\n");
+    char **files;
+    int count;
+    atomic_int next;
+    atomic_int failures;
+} BatchQueue;
 
-    codeLine *stmt = statements;
-    while (stmt)
+void *batchWorker(void *arg)
+{
+    BatchQueue *queue = arg;
+    int i;
+    while ((i = atomic_fetch_add(&queue->next, 1)) < queue->count)
     {
-        if (stmt->expr && stmt->expr->type == EXPR_NUM)
+        if (!compileFile(queue->files[i]))
         {
-            ensureConstantExists(stmt->expr->num);
+            fprintf(stderr, "Erro: falha ao compilar %s\n", queue->files[i]);
+            atomic_fetch_add(&queue->failures, 1);
         }
-        stmt = stmt->next;
     }
+    return NULL;
+}
 
-    for (int i = 0; i < varCount; i++)
+/**
+ * compileBatch – compila vários arquivos num conjunto de threads
+ * @jobs: número de threads
+ *
+ * @return: número de arquivos que falharam
+ */
+int compileBatch(char **files, int count, int jobs)
+{
+    if (jobs > count)
+        jobs = count;
+    BatchQueue queue = {.files = files, .count = count};
+    atomic_init(&queue.next, 0);
+    atomic_init(&queue.failures, 0);
+    pthread_t *threads = malloc(jobs * sizeof(pthread_t));
+    if (!threads)
     {
-        if (strcmp(varTable[i].name, "ONE") == 0 ||
-            strcmp(varTable[i].name, "CONST_0") == 0 ||
-            strcmp(varTable[i].name, "CONST_1") == 0 ||
-            strcmp(varTable[i].name, "NEG_1") == 0 ||
-            strcmp(varTable[i].name, "RES") == 0)
-            continue;
-
-        if (strncmp(varTable[i].name, "TEMP_", 5) == 0)
-        {
-            fprintf(asmOut, "%s DB ?\n", varTable[i].name);
-        }
-        else if (strncmp(varTable[i].name, "CONST_", 6) == 0)
-        {
-            fprintf(asmOut, "%s DB %d\n", varTable[i].name, varTable[i].value);
-        }
-        else if (!varTable[i].defined)
-        {
-            fprintf(asmOut, "%s DB ?\n", varTable[i].name);
-        }
-        else
-        {
-            fprintf(asmOut, "%s DB %d\n", varTable[i].name, varTable[i].value);
-        }
+        perror("Erro ao alocar memória");
+        return count;
     }
 
-    fprintf(asmOut, "\n.CODE\n");
-    fprintf(asmOut, ".ORG 0\n");
-
-    stmt = statements;
-    while (stmt)
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int started = 0;
+    for (; started < jobs; started++)
     {
-        fprintf(asmOut, "; Atribuição: %s = ...\n", stmt->var);
-        emitAssignmentCode(stmt);
-        stmt = stmt->next;
+        if (pthread_create(&threads[started], NULL, batchWorker, &queue) != 0)
+            break;
     }
+    if (started == 0)
+        batchWorker(&queue);
+    for (int t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(threads);
 
-    fprintf(asmOut, "; Expressão final do resultado\n");
-    emitExprCode(program.resultExpr);
-    fprintf(asmOut, "STA RES\n");
-    fprintf(asmOut, "HLT\n");
-
-    printf("Depuração: Código assembly gerado com sucesso!\n");
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    int failures = atomic_load(&queue.failures);
+    printf("Lote: %d arquivos (%d falhas) em %.3f s com %d threads: %.0f arquivos/s\n", count, failures, seconds,
+           started ? started : 1, seconds > 0 ? count / seconds : 0.0);
+    return failures;
 }
 
 int main(int argc, char **argv)
 {
-    if (argc < 2)
+    char **inputFiles = malloc((argc + 1) * sizeof(char *));
+    int inputCount = 0;
+    int jobs = 0;
+    bool forceAssembly = false;
+    if (!inputFiles)
     {
-        printf("Uso: %s programa.lpn\n", argv[0]);
+        perror("Erro ao alocar memória");
         return 1;
     }
-
-    FILE *fp = fopen(argv[1], "r");
-    if (!fp)
+    for (int i = 1; i < argc; i++)
     {
-        perror("Erro ao abrir o arquivo .lpn");
+        if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0)
+            verbose = false;
+        else if (strcmp(argv[i], "--div-subtract") == 0)
+            divideBySubtraction = true;
+        else if (strcmp(argv[i], "--int16") == 0)
+            wideIntegers = true;
+        else if (strcmp(argv[i], "--emit-bin") == 0)
+            emitBinary = true;
+        else if (strcmp(argv[i], "--emit-asm") == 0)
+            forceAssembly = true;
+        else if (strcmp(argv[i], "--eval") == 0)
+            evalMode = EVAL_ONLY;
+        else if (strcmp(argv[i], "--eval-check") == 0)
+            evalMode = EVAL_CHECK;
+        else if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0 || strcmp(argv[i], "-O2") == 0)
+            optimizationLevel = argv[i][2] - '0';
+        else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) && i + 1 < argc)
+            jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            cacheDir = argv[++i];
+        else if (strcmp(argv[i], "--time-report") == 0)
+            timeReport = true;
+        else if (strcmp(argv[i], "--time-report=json") == 0)
+            timeReport = timeReportJson = true;
+        else if (strcmp(argv[i], "--lex-bench") == 0)
+            lexBenchmark = true;
+        else
+            inputFiles[inputCount++] = argv[i];
+    }
+    if (inputCount == 0)
+    {
+        printf("Uso: %s [-q] [-O0|-O1|-O2] [--div-subtract] [--int16] [--emit-bin [--emit-asm]] [--eval | --eval-check] "
+               "[-j N] [--cache DIR] [--time-report[=json]] [--lex-bench] programa.lpn...\n",
+               argv[0]);
+        free(inputFiles);
         return 1;
     }
-
-    fseek(fp, 0, SEEK_END);
-    long fileSize = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
-    source = (char *)malloc(fileSize + 1);
-    if (!source)
+    if (evalMode == EVAL_CHECK && divideBySubtraction)
     {
-        perror("Erro ao alocar memória");
-        fclose(fp);
+        /* o laço de subtrações divide com sinal e o bytecode sem sinal: toda
+         * divisão com operando >= 128 viraria uma divergência falsa */
+        printf("Erro: --eval-check não se aplica a --div-subtract\n");
+        free(inputFiles);
         return 1;
     }
-
-    size_t bytesRead = fread(source, 1, fileSize, fp);
-    source[bytesRead] = '\0';
-    fclose(fp);
-
-    char outputFile[256];
-    strncpy(outputFile, argv[1], sizeof(outputFile) - 5);
-    outputFile[sizeof(outputFile) - 5] = '\0';
-    char *dot = strrchr(outputFile, '.');
-    if (dot)
-        *dot = '\0';
-    strcat(outputFile, ".asm");
-
-    asmOut = fopen(outputFile, "w");
-    if (!asmOut)
+    if (wideIntegers && divideBySubtraction)
+    {
+        printf("Aviso: --div-subtract não se aplica a --int16; ignorado\n");
+        divideBySubtraction = false;
+    }
+    emitAssembly = evalMode != EVAL_ONLY && (!emitBinary || forceAssembly);
+    emitBinary = emitBinary && evalMode != EVAL_ONLY;
+    if (cacheDir && mkdir(cacheDir, 0777) != 0 && errno != EEXIST)
     {
-        perror("Erro ao criar arquivo de saída .asm");
-        free(source);
+        perror("Erro ao criar o diretório do cache");
+        free(inputFiles);
         return 1;
     }
 
-    statements = NULL;
-    lastStmt = NULL;
-    varCount = 0;
-    tempCount = 0;
-
-    tokenizeInput();
-
-    parseCompilationUnit();
-
-    emitAssemblyCode();
-
-    freeCodeLines(statements);
-    freeAST(program.resultExpr);
-    free(source);
-    fclose(asmOut);
-
-    printf("\nCompilação concluída com sucesso: %s\n", outputFile);
-    return 0;
-}
\ No newline at end of file
+    int status;
+    if (inputCount == 1)
+    {
+        status = compileFile(inputFiles[0]) ? 0 : 1;
+    }
+    else
+    {
+        /* em lote a saída de depuração das threads se misturaria */
+        batchMode = true;
+        verbose = false;
+        if (timeReport)
+            printf("Aviso: --time-report vale só para um arquivo; ignorado no lote\n");
+        if (jobs <= 0)
+            jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        status = compileBatch(inputFiles, inputCount, jobs > 0 ? jobs : 1) ? 1 : 0;
+    }
+    if (cacheDir)
+        printf("Cache: %d acertos, %d faltas\n", atomic_load(&cacheHits), atomic_load(&cacheMisses));
+    free(inputFiles);
+    return status;
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "neander.h"
+
+/**
+ * convertImage – converte imagem entre os formatos legado (NDR) e compacto (NDC)
+ * @inputFile: imagem de entrada, em qualquer um dos formatos
+ * @outputFile: imagem de saída
+ * @toCompact: true para gravar NDC, false para gravar NDR
+ *
+ * @return: true se sucesso, false caso erro
+ */
+bool convertImage(const char *inputFile, const char *outputFile, bool toCompact)
+{
+    uint8_t *memory = calloc(WIDEMEMORYSIZE, 1);
+    if (!memory)
+    {
+        perror("Erro ao alocar memória");
+        return false;
+    }
+    ImageLayout layout;
+    if (!load_image(inputFile, memory, WIDEMEMORYSIZE, &layout))
+    {
+        free(layout.symbols);
+        free(memory);
+        return false;
+    }
+
+    bool ok;
+    if (toCompact)
+    {
+        ok = write_compact_image(outputFile, memory, &layout);
+    }
+    else
+    {
+        if ((layout.flags & COMPACTFLAGWIDE) ||
+            HEADERSIZE + 2 * (layout.codeBase + layout.codeWords) > LEGACYIMAGESIZE ||
+            HEADERSIZE + 2 * (layout.dataBase + layout.dataWords) > LEGACYIMAGESIZE)
+        {
+            fprintf(stderr, "Erro: imagem nao cabe no formato legado\n");
+            free(layout.symbols);
+            free(memory);
+            return false;
+        }
+        if (layout.entry != layout.codeBase)
+            printf("Aviso: ponto de entrada %d sera perdido no formato legado\n", layout.entry);
+        if (layout.symbolCount > 0)
+            printf("Aviso: %d simbolos descartados no formato legado\n", layout.symbolCount);
+        ok = write_legacy_image(outputFile, memory);
+    }
+
+    if (ok)
+        printf("Convertido: %s (%s) -> %s (%s), codigo %d palavras, dados %d palavras\n",
+               inputFile, layout.compact ? "NDC" : "NDR", outputFile, toCompact ? "NDC" : "NDR",
+               layout.codeWords, layout.dataWords);
+    free(layout.symbols);
+    free(memory);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *inputFile = NULL;
+    const char *outputFile = NULL;
+    int target = -1; /* -1: formato oposto ao da entrada */
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--compact") == 0)
+            target = 1;
+        else if (strcmp(argv[i], "--legacy") == 0)
+            target = 0;
+        else if (!inputFile)
+            inputFile = argv[i];
+        else
+            outputFile = argv[i];
+    }
+    if (!inputFile || !outputFile)
+    {
+        printf("Uso: %s entrada.bin saida.bin [--compact | --legacy]\n", argv[0]);
+        return 1;
+    }
+
+    if (target < 0)
+    {
+        FILE *fp = fopen(inputFile, "rb");
+        if (!fp)
+        {
+            perror("Nao e possível abrir o arquivo binario");
+            return 1;
+        }
+        target = fgetc(fp) == 0x03;
+        fclose(fp);
+    }
+
+    if (!convertImage(inputFile, outputFile, target == 1))
+    {
+        fprintf(stderr, "Conversao falhou.\n");
+        return 1;
+    }
+    return 0;
+}
@@ -4,25 +4,13 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
+#include "neander.h"
 
 #define MEMORY_SIZE 516
 #define LINE_SIZE 16
 #define HEADER_SIZE 4
 #define DATA_OFFSET 0x100
 
-#define OPCODE_NOP 0x00 // Sem operação
-#define OPCODE_STA 0x10 // Armazena acumulador em memória
-#define OPCODE_LDA 0x20 // Carrega acumulador da memória
-#define OPCODE_ADD 0x30 // Soma memória ao acumulador
-#define OPCODE_SUB 0x31 // Subtrai memória do acumulador
-#define OPCODE_OR 0x40  // OR lógico
-#define OPCODE_AND 0x50 // AND lógico
-#define OPCODE_NOT 0x60 // NOT lógico
-#define OPCODE_JMP 0x80 // Salto incondicional
-#define OPCODE_JMN 0x90 // Salto se acumulador negativo
-#define OPCODE_JMZ 0xA0 // Salto se acumulador zero
-#define OPCODE_HLT 0xF0 // Parada
-
 #define DEFAULT_RESULT_OFFSET (DATA_OFFSET + 4)
 
 /**
@@ -124,18 +112,19 @@ void removeCommentsAndTrim(char *line)
 }
 
 /**
- * printMemoryDump – exibe dump de memória em linhas de bytes
+ * printMemoryRange – exibe dump de um trecho da memória em linhas de bytes
  * @memory: ponteiro para buffer de memória
- * @length: tamanho a exibir
+ * @start: offset inicial
+ * @end: offset final (exclusivo)
  *
  * @return: void
  */
-void printMemoryDump(uint8_t *memory, size_t length)
+void printMemoryRange(uint8_t *memory, size_t start, size_t end)
 {
-    for (size_t i = 0; i < length; i += LINE_SIZE)
+    for (size_t i = start; i < end; i += LINE_SIZE)
     {
         printf("%08lx:", i);
-        for (int j = 0; j < LINE_SIZE && i + j < length; j++)
+        for (int j = 0; j < LINE_SIZE && i + j < end; j++)
         {
             printf(" %02x", memory[i + j]);
         }
@@ -144,106 +133,94 @@ void printMemoryDump(uint8_t *memory, size_t length)
     printf("\n");
 }
 
+/**
+ * printMemoryDump – exibe dump de memória em linhas de bytes
+ * @memory: ponteiro para buffer de memória
+ * @length: tamanho a exibir
+ *
+ * @return: void
+ */
+void printMemoryDump(uint8_t *memory, size_t length)
+{
+    printMemoryRange(memory, 0, length);
+}
+
+/**
+ * printImageDump – exibe a memória inteira (modo legado) ou só os segmentos (modo estendido)
+ */
+void printImageDump(uint8_t *memory, const ImageLayout *layout, bool wide)
+{
+    if (!wide)
+    {
+        printMemoryDump(memory, MEMORY_SIZE);
+        return;
+    }
+    printMemoryRange(memory, HEADER_SIZE + 2 * layout->codeBase, HEADER_SIZE + 2 * (layout->codeBase + layout->codeWords));
+    printMemoryRange(memory, HEADER_SIZE + 2 * layout->dataBase, HEADER_SIZE + 2 * (layout->dataBase + layout->dataWords));
+}
+
 /**
  * executeBinaryFile – carrega e executa binário em memória simulada
  * @filename: nome do arquivo .bin
  *
+ * Imagens com COMPACTFLAGWIDE usam operandos de 16 bits (byte alto da
+ * palavra do operando) e endereçam até 64K palavras.
+ *
  * @return: true se sucesso, false se erro
  */
 bool executeBinaryFile(const char *filename)
 {
-    FILE *fp = fopen(filename, "rb");
-    if (!fp)
+    uint8_t *memory = calloc(WIDEMEMORYSIZE, 1);
+    if (!memory)
     {
-        perror("Nao e possível abrir o arquivo binario");
+        perror("Erro ao alocar memória");
         return false;
     }
-
-    uint8_t memory[MEMORY_SIZE] = {0};
-    uint8_t header[HEADER_SIZE];
-    fread(header, 1, HEADER_SIZE, fp);
-
-    const uint8_t expectedHeader[] = {0x03, 0x4E, 0x44, 0x52};
-    if (memcmp(header, expectedHeader, HEADER_SIZE) != 0)
+    ImageLayout layout;
+    if (!load_image(filename, memory, WIDEMEMORYSIZE, &layout))
     {
-        printf("Header binario invalido\n");
-        fclose(fp);
+        free(layout.symbols);
+        free(memory);
         return false;
     }
+    bool wide = layout.flags & COMPACTFLAGWIDE;
+    size_t memorySize = wide ? WIDEMEMORYSIZE : MEMORY_SIZE;
+    if (layout.compact)
+        printf("Imagem compacta v%d%s: codigo %d palavras, dados %d palavras, %d simbolos\n\n",
+               layout.version, wide ? " (modo estendido)" : "", layout.codeWords, layout.dataWords,
+               layout.symbolCount);
 
-    fread(memory + HEADER_SIZE, 1, MEMORY_SIZE - HEADER_SIZE, fp);
-    fclose(fp);
-
-    printMemoryDump(memory, MEMORY_SIZE);
-
-    uint8_t accumulator = 0;
-    uint8_t programCounter = 0;
-    bool zeroFlag = false, negativeFlag = false;
-
-    while (memory[programCounter] != OPCODE_HLT)
-    {
-        zeroFlag = (accumulator == 0);
-        negativeFlag = (accumulator & 0x80);
-
-        uint16_t operandAddr = memory[programCounter + 2] * 2 + HEADER_SIZE;
-
-        switch (memory[programCounter])
-        {
-        case OPCODE_NOP:
-            break;
-        case OPCODE_STA:
-            memory[operandAddr] = accumulator;
-            break;
-        case OPCODE_LDA:
-            accumulator = memory[operandAddr];
-            break;
-        case OPCODE_ADD:
-            accumulator += memory[operandAddr];
-            break;
-        case OPCODE_SUB:
-            accumulator -= memory[operandAddr];
-            break;
-        case OPCODE_OR:
-            accumulator |= memory[operandAddr];
-            break;
-        case OPCODE_AND:
-            accumulator &= memory[operandAddr];
-            break;
-        case OPCODE_NOT:
-            accumulator = ~accumulator;
-            programCounter += 2;
-            continue;
-        case OPCODE_JMP:
-            programCounter = operandAddr;
-            continue;
-        case OPCODE_JMN:
-            if (negativeFlag)
-            {
-                programCounter = operandAddr;
-                continue;
-            }
-            break;
-        case OPCODE_JMZ:
-            if (zeroFlag)
-            {
-                programCounter = operandAddr;
-                continue;
-            }
-            break;
-        case OPCODE_HLT:
-            break;
-        }
+    printImageDump(memory, &layout, wide);
 
-        programCounter += 4;
-    }
+    /* imagens legadas começam no cabeçalho (NOP) como antes; compactas no ponto de entrada */
+    NeanderState state = {0, layout.compact ? HEADER_SIZE + layout.entry * 2 : 0, 0};
+    run_neander(memory, memorySize, wide, &state, 0);
+    uint8_t accumulator = state.accumulator;
 
-    printMemoryDump(memory, MEMORY_SIZE);
+    printImageDump(memory, &layout, wide);
 
     printf("AC: 0x%02X\n", accumulator);
-    printf("PC: 0x%02X\n", programCounter);
+    printf(wide ? "PC: 0x%04X\n" : "PC: 0x%02X\n", state.programCounter);
+    printf("Instrucoes executadas: %lu\n", state.executed);
 
     int found = 0;
-    for (int i = HEADER_SIZE; i < MEMORY_SIZE; i += 2)
+    int resWord = find_image_symbol(&layout, "RES");
+    int resHighWord = find_image_symbol(&layout, "RES.HI");
+    if (resWord >= 0 && resHighWord >= 0 && HEADER_SIZE + (size_t)resHighWord * 2 < memorySize &&
+        HEADER_SIZE + (size_t)resWord * 2 < memorySize)
+    {
+        /* compilador com --int16: RES.HI guarda o byte alto */
+        uint16_t res = memory[HEADER_SIZE + resWord * 2] | memory[HEADER_SIZE + resHighWord * 2] << 8;
+        printf("Resultado: 0x%04X = %d\n", res, (int16_t)res);
+        found = 1;
+    }
+    else if (resWord >= 0 && HEADER_SIZE + (size_t)resWord * 2 < memorySize)
+    {
+        uint8_t res = memory[HEADER_SIZE + resWord * 2];
+        printf("Resultado: 0x%02X = %d\n", res, (int8_t)res);
+        found = 1;
+    }
+    for (size_t i = HEADER_SIZE; !found && i < memorySize; i += 2)
     {
         if (memory[i] == accumulator)
         {
@@ -255,6 +232,8 @@ bool executeBinaryFile(const char *filename)
 
     if (!found)
         printf("Resultado não encontrando na memoria\n");
+    free(layout.symbols);
+    free(memory);
     return true;
 }
 
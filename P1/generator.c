@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define MAX_VARIABLES 64
+#define MAX_DEPTH 12
+
+/**
+ * GeneratorOptions – forma da carga gerada (linha de comando)
+ */
+typedef struct
+{
+    uint64_t seed;
+    int programCount;
+    int statementCount;
+    int maxDepth;
+    int variableCount;
+    const char *operators; /* mistura de operadores; repetir um operador aumenta o seu peso */
+    int width;             /* 8 ou 16 bits: aritmética de referência e faixa dos literais */
+} GeneratorOptions;
+
+GeneratorOptions options = {1, 1, 20, 3, 8, "+-*/", 8};
+
+uint64_t rngState;
+
+/**
+ * nextRandom – xorshift64*: a mesma semente gera a mesma carga em qualquer plataforma
+ */
+uint64_t nextRandom()
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 2685821657736338717ull;
+}
+
+/**
+ * randomBelow – inteiro uniforme em [0, limit)
+ */
+int randomBelow(int limit)
+{
+    return (int)((nextRandom() >> 33) % (uint64_t)limit);
+}
+
+/**
+ * ExprNode – nó da expressão gerada; folhas têm op 0
+ */
+typedef struct
+{
+    char op;
+    int variable; /* folha: índice da variável, -1 para literal */
+    int value;    /* literal ou valor calculado pelo avaliador de referência */
+    int left;
+    int right;
+} ExprNode;
+
+ExprNode nodes[4 << MAX_DEPTH]; /* árvore completa mais os divisores trocados */
+int nodeCount;
+
+int values[MAX_VARIABLES];
+bool assigned[MAX_VARIABLES];
+
+/**
+ * wrap – reduz o valor à largura da carga, como o código Neander gerado
+ */
+int wrap(int value)
+{
+    return value & (options.width == 16 ? 0xFFFF : 0xFF);
+}
+
+/**
+ * randomLiteral – literal pequeno na maioria das vezes, às vezes da largura toda
+ */
+int randomLiteral()
+{
+    int roll = randomBelow(10);
+    if (roll < 6)
+        return randomBelow(16);
+    if (roll < 9 || options.width == 8)
+        return randomBelow(256);
+    return randomBelow(65536);
+}
+
+/**
+ * newLeaf – folha: variável já atribuída, às vezes uma entrada nunca atribuída, ou literal
+ */
+int newLeaf()
+{
+    ExprNode *node = &nodes[nodeCount];
+    node->op = 0;
+    node->variable = -1;
+    int variable = randomBelow(options.variableCount);
+    if (randomBelow(2) == 0 && (assigned[variable] || randomBelow(8) == 0))
+    {
+        node->variable = variable;
+        node->value = values[variable];
+    }
+    else
+    {
+        node->value = randomLiteral();
+    }
+    return nodeCount++;
+}
+
+/**
+ * evaluateBinary – avaliador de referência: 8 ou 16 bits com volta, divisão sem sinal, x/0 = 0
+ */
+int evaluateBinary(char op, int left, int right)
+{
+    switch (op)
+    {
+    case '+':
+        return wrap(left + right);
+    case '-':
+        return wrap(left - right);
+    case '*':
+        return wrap((int)(((unsigned)left * (unsigned)right) & 0xFFFF));
+    default:
+        return right ? left / right : 0;
+    }
+}
+
+/**
+ * generateExpr – árvore aleatória de até depth níveis de operadores
+ * @return: índice do nó raiz
+ *
+ * Um divisor que vale zero é trocado por um literal não nulo: x/0 = 0 é
+ * definido, mas o compilador o reporta como erro quando o divisor é
+ * conhecido, o que poluiria a saída da carga.
+ */
+int generateExpr(int depth)
+{
+    if (depth == 0 || randomBelow(4) == 0)
+        return newLeaf();
+    char op = options.operators[randomBelow((int)strlen(options.operators))];
+    int left = generateExpr(depth - 1);
+    int right = generateExpr(depth - 1);
+    if (op == '/' && nodes[right].value == 0)
+    {
+        right = newLeaf();
+        nodes[right].variable = -1;
+        nodes[right].value = 1 + randomBelow(9);
+    }
+    ExprNode *node = &nodes[nodeCount];
+    node->op = op;
+    node->variable = -1;
+    node->left = left;
+    node->right = right;
+    node->value = evaluateBinary(op, nodes[left].value, nodes[right].value);
+    return nodeCount++;
+}
+
+int precedence(char op)
+{
+    return op == '+' || op == '-' ? 1 : op == '*' || op == '/' ? 2 : 3;
+}
+
+/**
+ * writeExpr – imprime a expressão só com os parênteses necessários
+ *
+ * Os operadores associam à esquerda: o filho direito de mesma precedência
+ * precisa de parênteses; assim a carga também exercita a precedência do parser.
+ */
+void writeExpr(FILE *out, int index, int parentPrecedence, bool rightChild)
+{
+    ExprNode *node = &nodes[index];
+    if (!node->op)
+    {
+        if (node->variable >= 0)
+            fprintf(out, "v%d", node->variable);
+        else
+            fprintf(out, "%d", node->value);
+        return;
+    }
+    int own = precedence(node->op);
+    bool parens = own < parentPrecedence || (rightChild && own == parentPrecedence);
+    if (parens)
+        fputc('(', out);
+    writeExpr(out, node->left, own, false);
+    fprintf(out, " %c ", node->op);
+    writeExpr(out, node->right, own, true);
+    if (parens)
+        fputc(')', out);
+}
+
+/**
+ * generateProgram – grava um programa .lpn e devolve o RES de referência
+ */
+int generateProgram(FILE *out, const char *name)
+{
+    memset(values, 0, sizeof(values));
+    memset(assigned, 0, sizeof(assigned));
+    fprintf(out, "PROGRAMA \"%s\":\nINICIO\n", name);
+    for (int s = 0; s < options.statementCount; s++)
+    {
+        int variable = randomBelow(options.variableCount);
+        nodeCount = 0;
+        int root = generateExpr(1 + randomBelow(options.maxDepth));
+        fprintf(out, "v%d = ", variable);
+        writeExpr(out, root, 0, false);
+        fputc('\n', out);
+        values[variable] = nodes[root].value;
+        assigned[variable] = true;
+    }
+    nodeCount = 0;
+    int root = generateExpr(options.maxDepth);
+    fprintf(out, "RES = ");
+    writeExpr(out, root, 0, false);
+    fprintf(out, "\nFIM\n");
+    return nodes[root].value;
+}
+
+/**
+ * formatResult – RES no formato do executor (Resultado: 0x.. = ..)
+ */
+void formatResult(char *buffer, int value)
+{
+    if (options.width == 16)
+        sprintf(buffer, "0x%04X = %d", value, (int16_t)value);
+    else
+        sprintf(buffer, "0x%02X = %d", value, (int8_t)value);
+}
+
+/**
+ * parseOption – lê o valor numérico de uma opção dentro dos limites
+ */
+bool parseOption(const char *text, int min, int max, int *value)
+{
+    char *end;
+    long parsed = strtol(text, &end, 10);
+    if (*end || parsed < min || parsed > max)
+        return false;
+    *value = (int)parsed;
+    return true;
+}
+
+/**
+ * parseSeed – lê a semente de -s: só dígitos, sem sinal, cabendo em 64 bits
+ */
+bool parseSeed(const char *text, uint64_t *value)
+{
+    char *end;
+    errno = 0;
+    unsigned long long parsed = strtoull(text, &end, 10);
+    if (*text < '0' || *text > '9' || *end || errno == ERANGE)
+        return false;
+    *value = parsed;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output = NULL;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "-s") == 0 && value)
+            ok = parseSeed(argv[++i], &options.seed);
+        else if (strcmp(argv[i], "-c") == 0 && value)
+            ok = parseOption(argv[++i], 1, 99999, &options.programCount);
+        else if (strcmp(argv[i], "-n") == 0 && value)
+            ok = parseOption(argv[++i], 0, 10000000, &options.statementCount);
+        else if (strcmp(argv[i], "-d") == 0 && value)
+            ok = parseOption(argv[++i], 1, MAX_DEPTH, &options.maxDepth);
+        else if (strcmp(argv[i], "-v") == 0 && value)
+            ok = parseOption(argv[++i], 1, MAX_VARIABLES, &options.variableCount);
+        else if (strcmp(argv[i], "-w") == 0 && value)
+            ok = parseOption(argv[++i], 8, 16, &options.width) && (options.width == 8 || options.width == 16);
+        else if (strcmp(argv[i], "-o") == 0 && value)
+        {
+            options.operators = argv[++i];
+            ok = *options.operators && strspn(options.operators, "+-*/") == strlen(options.operators);
+        }
+        else if (argv[i][0] == '-')
+            ok = false; /* opção desconhecida ou sem valor: não vira nome de saída */
+        else if (!output)
+            output = argv[i];
+        else
+            ok = false;
+    }
+    if (!ok || !output)
+    {
+        printf("Uso: %s [-s semente] [-c programas] [-n atribuições] [-d profundidade] [-v variáveis] "
+               "[-o +-*/] [-w 8|16] saida\n"
+               "  saida terminada em .lpn recebe um programa; senão é um diretório com\n"
+               "  p0001.lpn... e esperado.txt (RES de referência de cada um)\n",
+               argv[0]);
+        return 1;
+    }
+    rngState = options.seed * 0x9E3779B97F4A7C15ull + 1;
+
+    char result[32];
+    size_t length = strlen(output);
+    if (length > 4 && strcmp(output + length - 4, ".lpn") == 0)
+    {
+        if (options.programCount != 1)
+        {
+            fprintf(stderr, "Erro: -c %d pede um diretório de saída\n", options.programCount);
+            return 1;
+        }
+        FILE *out = fopen(output, "w");
+        if (!out)
+        {
+            perror("Erro ao criar o arquivo .lpn");
+            return 1;
+        }
+        formatResult(result, generateProgram(out, "CARGA"));
+        fclose(out);
+        printf("RES esperado: %s\n", result);
+        return 0;
+    }
+
+    if (mkdir(output, 0777) != 0 && errno != EEXIST)
+    {
+        perror("Erro ao criar o diretório da carga");
+        return 1;
+    }
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/esperado.txt", output);
+    FILE *expected = fopen(path, "w");
+    if (!expected)
+    {
+        perror("Erro ao criar esperado.txt");
+        return 1;
+    }
+    for (int p = 1; p <= options.programCount; p++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "p%04d", p);
+        snprintf(path, sizeof(path), "%s/%s.lpn", output, name);
+        FILE *out = fopen(path, "w");
+        if (!out)
+        {
+            perror("Erro ao criar o arquivo .lpn");
+            fclose(expected);
+            return 1;
+        }
+        formatResult(result, generateProgram(out, name));
+        fclose(out);
+        fprintf(expected, "%s %s\n", name, result);
+    }
+    fclose(expected);
+    printf("Carga: %d programas em %s (semente %llu, %d atribuições, profundidade %d, operadores %s, %d bits)\n",
+           options.programCount, output, (unsigned long long)options.seed, options.statementCount,
+           options.maxDepth, options.operators, options.width);
+    return 0;
+}
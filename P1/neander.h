@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define MEMORYSIZE 516
@@ -11,10 +12,84 @@
 #define HEADERSIZE 4
 #define RESULTOFFSET 0x202
 
+/* imagem legada: cabeçalho 0x03 'N' 'D' 'R' seguido da memória, uma palavra a cada 2 bytes */
+#define LEGACYIMAGESIZE 512
+#define DATAWORD 126 /* palavra correspondente ao offset 0x100 */
+
+/* imagem compacta: cabeçalho 0x04 'N' 'D' 'C' e segmentos densos (1 byte por palavra,
+ * ou 2 no modo estendido) */
+#define COMPACTVERSION 1
+#define COMPACTHEADERSIZE 20
+#define COMPACTFLAGSYMBOLS 0x01
+#define COMPACTFLAGWIDE 0x02 /* modo estendido: operandos de 16 bits, 2 bytes por palavra */
+
+/* modo estendido: até 64K palavras endereçáveis */
+#define WIDEWORDS 65536
+#define WIDEMEMORYSIZE (HEADERSIZE + 2 * WIDEWORDS + 4)
+
+#define SYMBOLNAMESIZE 32
+
+#define OPCODE_NOP 0x00 // Sem operação
+#define OPCODE_STA 0x10 // Armazena acumulador em memória
+#define OPCODE_LDA 0x20 // Carrega acumulador da memória
+#define OPCODE_ADD 0x30 // Soma memória ao acumulador
+#define OPCODE_SUB 0x31 // Subtrai memória do acumulador
+#define OPCODE_OR 0x40  // OR lógico
+#define OPCODE_AND 0x50 // AND lógico
+#define OPCODE_NOT 0x60 // NOT lógico
+#define OPCODE_JMP 0x80 // Salto incondicional
+#define OPCODE_JMN 0x90 // Salto se acumulador negativo
+#define OPCODE_JMZ 0xA0 // Salto se acumulador zero
+#define OPCODE_HLT 0xF0 // Parada
+
+/**
+ * ImageSymbol – símbolo opcional gravado na imagem compacta
+ */
+typedef struct {
+    char name[SYMBOLNAMESIZE];
+    uint16_t address; /* endereço em palavras */
+} ImageSymbol;
+
+/**
+ * ImageLayout – descrição dos segmentos de uma imagem carregada ou a gravar
+ */
+typedef struct {
+    bool compact;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t entry; /* palavra da primeira instrução */
+    uint16_t codeBase;
+    uint16_t codeWords;
+    uint16_t dataBase;
+    uint16_t dataWords;
+    ImageSymbol *symbols;
+    uint16_t symbolCount;
+} ImageLayout;
+
+/**
+ * NeanderState – registradores da máquina; run_neander parte de programCounter
+ */
+typedef struct {
+    uint8_t accumulator;
+    uint32_t programCounter;
+    unsigned long executed;
+} NeanderState;
+
 void print_memory(uint8_t *bytes, size_t size);
+bool run_neander(uint8_t *memory, size_t size, bool wide, NeanderState *state, unsigned long stepLimit);
+bool load_image(const char *path, uint8_t *memory, size_t size, ImageLayout *layout);
+bool write_legacy_image(const char *path, const uint8_t *memory);
+bool write_compact_image(const char *path, const uint8_t *memory, const ImageLayout *layout);
+void scan_legacy_layout(const uint8_t *memory, ImageLayout *layout);
+int find_image_symbol(const ImageLayout *layout, const char *name);
 
 #endif // NEANDER_H
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 void print_memory(uint8_t *bytes, size_t size) {
     size_t offset = 0;
     while (offset < size) {
@@ -29,3 +104,308 @@ void print_memory(uint8_t *bytes, size_t size) {
         offset += LINESIZE;
     }
 }
+
+static const uint8_t legacyMagic[HEADERSIZE] = {0x03, 0x4E, 0x44, 0x52};
+static const uint8_t compactMagic[HEADERSIZE] = {0x04, 0x4E, 0x44, 0x43};
+
+static uint16_t read_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void put_u16(uint8_t *p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+/**
+ * load_image – carrega uma imagem legada (NDR) ou compacta (NDC) em memória
+ * @path: arquivo .bin
+ * @memory: memória de destino, zerada e no layout do executor (palavra i em 4 + 2i)
+ * @size: tamanho de memory em bytes
+ * @layout: recebe a descrição dos segmentos; symbols deve ser liberado com free
+ *
+ * O arquivo é mapeado com mmap e lido uma única vez.
+ *
+ * @return: true se sucesso, false caso o arquivo seja inválido
+ */
+bool load_image(const char *path, uint8_t *memory, size_t size, ImageLayout *layout) {
+    memset(layout, 0, sizeof(*layout));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Nao e possível abrir o arquivo binario");
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < HEADERSIZE) {
+        fprintf(stderr, "Arquivo binario vazio ou ilegivel\n");
+        close(fd);
+        return false;
+    }
+    size_t fileSize = (size_t)st.st_size;
+    const uint8_t *file = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) {
+        perror("Falha ao mapear o arquivo binario");
+        return false;
+    }
+
+    bool ok = false;
+    memset(memory, 0, size);
+    if (memcmp(file, legacyMagic, HEADERSIZE) == 0) {
+        size_t len = fileSize < size ? fileSize : size;
+        memcpy(memory + HEADERSIZE, file + HEADERSIZE, len - HEADERSIZE);
+        scan_legacy_layout(memory, layout);
+        ok = true;
+    } else if (memcmp(file, compactMagic, HEADERSIZE) == 0 && fileSize >= COMPACTHEADERSIZE) {
+        layout->compact = true;
+        layout->version = file[4];
+        layout->flags = file[5];
+        layout->entry = read_u16(file + 6);
+        layout->codeBase = read_u16(file + 8);
+        layout->codeWords = read_u16(file + 10);
+        layout->dataBase = read_u16(file + 12);
+        layout->dataWords = read_u16(file + 14);
+        layout->symbolCount = read_u16(file + 16);
+
+        size_t pos = COMPACTHEADERSIZE;
+        size_t wordBytes = (layout->flags & COMPACTFLAGWIDE) ? 2 : 1;
+        size_t segments = ((size_t)layout->codeWords + layout->dataWords) * wordBytes;
+        if (layout->version != COMPACTVERSION) {
+            fprintf(stderr, "Versao de imagem compacta nao suportada: %d\n", layout->version);
+        } else if (pos + segments > fileSize ||
+                   HEADERSIZE + 2 * ((size_t)layout->codeBase + layout->codeWords) > size ||
+                   HEADERSIZE + 2 * ((size_t)layout->dataBase + layout->dataWords) > size) {
+            fprintf(stderr, "Imagem compacta truncada ou maior que a memoria\n");
+        } else {
+            for (size_t i = 0; i < layout->codeWords; i++, pos += wordBytes)
+                memcpy(memory + HEADERSIZE + 2 * (layout->codeBase + i), file + pos, wordBytes);
+            for (size_t i = 0; i < layout->dataWords; i++, pos += wordBytes)
+                memcpy(memory + HEADERSIZE + 2 * (layout->dataBase + i), file + pos, wordBytes);
+            ok = true;
+            if (layout->flags & COMPACTFLAGSYMBOLS) {
+                layout->symbols = calloc(layout->symbolCount ? layout->symbolCount : 1, sizeof(ImageSymbol));
+                for (uint16_t i = 0; i < layout->symbolCount; i++) {
+                    if (pos + 3 > fileSize || pos + 3 + file[pos + 2] > fileSize) {
+                        fprintf(stderr, "Secao de simbolos truncada\n");
+                        ok = false;
+                        break;
+                    }
+                    layout->symbols[i].address = read_u16(file + pos);
+                    size_t len = file[pos + 2];
+                    if (len >= SYMBOLNAMESIZE)
+                        len = SYMBOLNAMESIZE - 1;
+                    memcpy(layout->symbols[i].name, file + pos + 3, len);
+                    pos += 3 + file[pos + 2];
+                }
+            } else {
+                layout->symbolCount = 0;
+            }
+        }
+    } else {
+        printf("Header binario invalido\n");
+    }
+    munmap((void *)file, fileSize);
+    return ok;
+}
+
+/**
+ * write_legacy_image – grava a memória no formato 0x03 'NDR' (imagem completa)
+ * @path: arquivo de saída
+ * @memory: memória no layout do executor, com pelo menos LEGACYIMAGESIZE bytes
+ *
+ * @return: true se sucesso
+ */
+bool write_legacy_image(const char *path, const uint8_t *memory) {
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror("Falha ao criar o arquivo binario");
+        return false;
+    }
+    fwrite(legacyMagic, 1, HEADERSIZE, out);
+    fwrite(memory + HEADERSIZE, 1, LEGACYIMAGESIZE - HEADERSIZE, out);
+    fclose(out);
+    return true;
+}
+
+/**
+ * write_compact_image – grava os segmentos de código e dados em formato denso
+ * @path: arquivo de saída
+ * @memory: memória no layout do executor
+ * @layout: segmentos, ponto de entrada e símbolos opcionais
+ *
+ * Apenas o byte baixo de cada palavra é gravado, pois o alto é sempre zero,
+ * exceto com COMPACTFLAGWIDE, em que o byte alto carrega o operando de 16 bits.
+ *
+ * @return: true se sucesso
+ */
+bool write_compact_image(const char *path, const uint8_t *memory, const ImageLayout *layout) {
+    size_t wordBytes = (layout->flags & COMPACTFLAGWIDE) ? 2 : 1;
+    size_t size = COMPACTHEADERSIZE + ((size_t)layout->codeWords + layout->dataWords) * wordBytes;
+    bool withSymbols = (layout->flags & COMPACTFLAGSYMBOLS) && layout->symbols;
+    if (withSymbols)
+        for (uint16_t i = 0; i < layout->symbolCount; i++)
+            size += 3 + strlen(layout->symbols[i].name);
+
+    uint8_t *buffer = calloc(size, 1);
+    if (!buffer) {
+        perror("Erro ao alocar memória");
+        return false;
+    }
+    memcpy(buffer, compactMagic, HEADERSIZE);
+    buffer[4] = COMPACTVERSION;
+    buffer[5] = (layout->flags & COMPACTFLAGWIDE) | (withSymbols ? COMPACTFLAGSYMBOLS : 0);
+    put_u16(buffer + 6, layout->entry);
+    put_u16(buffer + 8, layout->codeBase);
+    put_u16(buffer + 10, layout->codeWords);
+    put_u16(buffer + 12, layout->dataBase);
+    put_u16(buffer + 14, layout->dataWords);
+    put_u16(buffer + 16, withSymbols ? layout->symbolCount : 0);
+
+    size_t pos = COMPACTHEADERSIZE;
+    for (size_t i = 0; i < layout->codeWords; i++, pos += wordBytes)
+        memcpy(buffer + pos, memory + HEADERSIZE + 2 * (layout->codeBase + i), wordBytes);
+    for (size_t i = 0; i < layout->dataWords; i++, pos += wordBytes)
+        memcpy(buffer + pos, memory + HEADERSIZE + 2 * (layout->dataBase + i), wordBytes);
+    if (withSymbols) {
+        for (uint16_t i = 0; i < layout->symbolCount; i++) {
+            size_t len = strlen(layout->symbols[i].name);
+            put_u16(buffer + pos, layout->symbols[i].address);
+            buffer[pos + 2] = (uint8_t)len;
+            memcpy(buffer + pos + 3, layout->symbols[i].name, len);
+            pos += 3 + len;
+        }
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror("Falha ao criar o arquivo binario");
+        free(buffer);
+        return false;
+    }
+    fwrite(buffer, 1, size, out);
+    fclose(out);
+    free(buffer);
+    return true;
+}
+
+/**
+ * scan_legacy_layout – deduz segmentos de uma imagem legada
+ * @memory: memória no layout do executor
+ * @layout: recebe código em [0, DATAWORD) e dados a partir de DATAWORD,
+ *          ambos sem as palavras nulas finais
+ */
+void scan_legacy_layout(const uint8_t *memory, ImageLayout *layout) {
+    uint16_t totalWords = (LEGACYIMAGESIZE - HEADERSIZE) / 2;
+    uint16_t codeEnd = DATAWORD;
+    while (codeEnd > 0 && memory[HEADERSIZE + 2 * (codeEnd - 1)] == 0)
+        codeEnd--;
+    uint16_t dataEnd = totalWords;
+    while (dataEnd > DATAWORD && memory[HEADERSIZE + 2 * (dataEnd - 1)] == 0)
+        dataEnd--;
+
+    layout->compact = false;
+    layout->version = 0;
+    layout->flags = 0;
+    layout->entry = 0;
+    layout->codeBase = 0;
+    layout->codeWords = codeEnd;
+    layout->dataBase = DATAWORD;
+    layout->dataWords = dataEnd - DATAWORD;
+    layout->symbols = NULL;
+    layout->symbolCount = 0;
+}
+
+/**
+ * run_neander – executa a memória até HLT, o fim da memória ou stepLimit instruções
+ * @memory: memória no layout do executor (palavra i em 4 + 2i)
+ * @size: MEMORYSIZE (legado) ou WIDEMEMORYSIZE (estendido)
+ * @wide: operandos de 16 bits; sem ele o PC tem 8 bits e dá a volta em 256,
+ *        como no Neander original
+ * @state: PC inicial e acumulador na entrada; registradores e contagem na saída
+ * @stepLimit: máximo de instruções, 0 para não limitar
+ *
+ * Único laço de execução: o executor e o oráculo do compilador (--eval-check)
+ * usam esta mesma função.
+ *
+ * @return: false se parou por stepLimit
+ */
+bool run_neander(uint8_t *memory, size_t size, bool wide, NeanderState *state, unsigned long stepLimit) {
+    uint8_t accumulator = state->accumulator;
+    uint32_t programCounter = state->programCounter;
+    uint32_t pcMask = wide ? 0xFFFFFFFF : 0xFF;
+    bool halted = true;
+    state->executed = 0;
+
+    while (programCounter + 3 < size && memory[programCounter] != OPCODE_HLT) {
+        if (stepLimit && state->executed == stepLimit) {
+            halted = false;
+            break;
+        }
+        bool zeroFlag = (accumulator == 0);
+        bool negativeFlag = (accumulator & 0x80);
+        state->executed++;
+
+        uint32_t operandWord = memory[programCounter + 2];
+        if (wide)
+            operandWord |= memory[programCounter + 3] << 8;
+        uint32_t operandAddr = operandWord * 2 + HEADERSIZE;
+
+        switch (memory[programCounter]) {
+        case OPCODE_STA:
+            memory[operandAddr] = accumulator;
+            break;
+        case OPCODE_LDA:
+            accumulator = memory[operandAddr];
+            break;
+        case OPCODE_ADD:
+            accumulator += memory[operandAddr];
+            break;
+        case OPCODE_SUB:
+            accumulator -= memory[operandAddr];
+            break;
+        case OPCODE_OR:
+            accumulator |= memory[operandAddr];
+            break;
+        case OPCODE_AND:
+            accumulator &= memory[operandAddr];
+            break;
+        case OPCODE_NOT:
+            accumulator = ~accumulator;
+            programCounter = (programCounter + 2) & pcMask;
+            continue;
+        case OPCODE_JMP:
+            programCounter = operandAddr & pcMask;
+            continue;
+        case OPCODE_JMN:
+            if (negativeFlag) {
+                programCounter = operandAddr & pcMask;
+                continue;
+            }
+            break;
+        case OPCODE_JMZ:
+            if (zeroFlag) {
+                programCounter = operandAddr & pcMask;
+                continue;
+            }
+            break;
+        }
+        programCounter = (programCounter + 4) & pcMask;
+    }
+
+    state->accumulator = accumulator;
+    state->programCounter = programCounter;
+    return halted;
+}
+
+/**
+ * find_image_symbol – procura símbolo na seção de símbolos da imagem
+ *
+ * @return: endereço em palavras, ou -1 se ausente
+ */
+int find_image_symbol(const ImageLayout *layout, const char *name) {
+    for (uint16_t i = 0; i < layout->symbolCount; i++) {
+        if (strcmp(layout->symbols[i].name, name) == 0)
+            return layout->symbols[i].address;
+    }
+    return -1;
+}
@@ -1,11 +1,14 @@
 package main
 
 import (
+	"errors"
+	"flag"
 	"fmt"
 	"io"
 	"os"
 	"strconv"
 	"strings"
+	"time"
 )
 
 func eval(expr string) int {
@@ -69,18 +72,196 @@ func eval(expr string) int {
 	return result
 }
 
-func main() {
-	const memorySize = 30000
-	mem := make([]byte, memorySize)
-	ptr := 0
+const memorySize = 30000
 
-	code, err := io.ReadAll(os.Stdin)
-	if err != nil {
-		fmt.Println("Erro ao ler entrada:", err)
-		return
+// Operações do IR. opAdd soma value à célula atual e opMove soma arg ao
+// ponteiro (sequências de +- e >< já somadas); opClear zera a célula ([-] e
+// [+]); opMulAdd soma value vezes a célula atual à célula arg posições
+// adiante, e uma sequência de opMulAdd seguida de opClear substitui um laço
+// de cópia/multiplicação como [>+++<-]. opJumpZero é o [ e opJumpNonZero o
+// ]; arg é o índice do colchete correspondente, e o pc++ do laço de
+// execução passa por ele.
+const (
+	opAdd uint8 = iota
+	opMove
+	opClear
+	opMulAdd
+	opOut
+	opIn
+	opJumpZero
+	opJumpNonZero
+)
+
+// instr ocupa 8 bytes; o programa inteiro é uma fatia contínua delas.
+type instr struct {
+	op    uint8
+	value uint8
+	arg   int32
+}
+
+// parse traduz o código Brainfuck para o IR uma única vez: agrupa +-<>
+// consecutivos, descarta os que se anulam, troca laços simples por
+// opClear/opMulAdd e resolve o destino de cada salto, para que a execução
+// nunca precise varrer o código em busca do ] certo.
+func parse(code []byte) ([]instr, error) {
+	prog := make([]instr, 0, len(code)/2)
+	loops := []int{}
+	for _, c := range code {
+		switch c {
+		case '+', '-':
+			delta := uint8(1)
+			if c == '-' {
+				delta = 255
+			}
+			if n := len(prog); n > 0 && prog[n-1].op == opAdd {
+				prog[n-1].value += delta
+				if prog[n-1].value == 0 {
+					prog = prog[:n-1]
+				}
+			} else {
+				prog = append(prog, instr{op: opAdd, value: delta})
+			}
+		case '>', '<':
+			delta := int32(1)
+			if c == '<' {
+				delta = -1
+			}
+			if n := len(prog); n > 0 && prog[n-1].op == opMove {
+				prog[n-1].arg += delta
+				if prog[n-1].arg == 0 {
+					prog = prog[:n-1]
+				}
+			} else {
+				prog = append(prog, instr{op: opMove, arg: delta})
+			}
+		case '.':
+			prog = append(prog, instr{op: opOut})
+		case ',':
+			prog = append(prog, instr{op: opIn})
+		case '[':
+			loops = append(loops, len(prog))
+			prog = append(prog, instr{op: opJumpZero})
+		case ']':
+			if len(loops) == 0 {
+				return nil, errors.New("']' sem '[' correspondente")
+			}
+			open := loops[len(loops)-1]
+			loops = loops[:len(loops)-1]
+			if simple, ok := simpleLoop(prog[open+1:]); ok {
+				prog = append(prog[:open], simple...)
+				continue
+			}
+			prog[open].arg = int32(len(prog))
+			prog = append(prog, instr{op: opJumpNonZero, arg: int32(open)})
+		}
 	}
+	if len(loops) > 0 {
+		return nil, errors.New("'[' sem ']' correspondente")
+	}
+	return prog, nil
+}
 
-	var output strings.Builder
+// simpleLoop reconhece um corpo de laço só com opAdd e opMove que volta à
+// célula de partida e soma 1 ou -1 a ela: o laço roda um número de vezes
+// conhecido ao entrar, então vira um opMulAdd por célula alterada e um
+// opClear. Um corpo que só soma um valor ímpar à célula ([-], [+]) vira só
+// opClear.
+func simpleLoop(body []instr) ([]instr, bool) {
+	var deltas [64]uint8
+	var offsets [64]int32
+	count := 0
+	offset := int32(0)
+	var step uint8
+	for _, in := range body {
+		switch in.op {
+		case opMove:
+			offset += in.arg
+		case opAdd:
+			if offset == 0 {
+				step += in.value
+				continue
+			}
+			i := 0
+			for i < count && offsets[i] != offset {
+				i++
+			}
+			if i == count {
+				if count == len(offsets) {
+					return nil, false
+				}
+				offsets[count] = offset
+				count++
+			}
+			deltas[i] += in.value
+		default:
+			return nil, false
+		}
+	}
+	if offset != 0 {
+		return nil, false
+	}
+	if count == 0 && step%2 == 1 {
+		return []instr{{op: opClear}}, true
+	}
+	// com -1 por volta o laço roda célula vezes; com +1, 256 - célula, o que
+	// equivale a multiplicar por -1
+	var sign uint8
+	switch step {
+	case 255:
+		sign = 1
+	case 1:
+		sign = 255
+	default:
+		return nil, false
+	}
+	out := make([]instr, 0, count+1)
+	for i := 0; i < count; i++ {
+		if deltas[i] != 0 {
+			out = append(out, instr{op: opMulAdd, value: deltas[i] * sign, arg: offsets[i]})
+		}
+	}
+	return append(out, instr{op: opClear}), true
+}
+
+// run executa o IR com a mesma semântica de runBytes.
+func run(prog []instr, mem []byte, output *strings.Builder) {
+	ptr := 0
+	input := make([]byte, 1)
+	for pc := 0; pc < len(prog); pc++ {
+		in := prog[pc]
+		switch in.op {
+		case opAdd:
+			mem[ptr] += in.value
+		case opMove:
+			ptr += int(in.arg)
+		case opClear:
+			mem[ptr] = 0
+		case opMulAdd:
+			if v := mem[ptr]; v != 0 {
+				mem[ptr+int(in.arg)] += v * in.value
+			}
+		case opOut:
+			output.WriteByte(mem[ptr])
+		case opIn:
+			input[0] = 0
+			os.Stdin.Read(input)
+			mem[ptr] = input[0]
+		case opJumpZero:
+			if mem[ptr] == 0 {
+				pc = int(in.arg)
+			}
+		case opJumpNonZero:
+			if mem[ptr] != 0 {
+				pc = int(in.arg)
+			}
+		}
+	}
+}
+
+// runBytes é o interpretador original, um byte do código por vez; fica só
+// como referência para -bench.
+func runBytes(code []byte, mem []byte, output *strings.Builder) {
+	ptr := 0
 	loopStack := []int{}
 	for pc := 0; pc < len(code); pc++ {
 		switch code[pc] {
@@ -120,6 +301,61 @@ func main() {
 			}
 		}
 	}
+}
+
+// benchmark executa o programa rounds vezes em cada interpretador, com
+// memória nova a cada rodada, e confere que as saídas são iguais. O tempo do
+// IR inclui a análise.
+func benchmark(code []byte, rounds int) {
+	var byteOutput, irOutput strings.Builder
+	var prog []instr
+
+	start := time.Now()
+	for i := 0; i < rounds; i++ {
+		byteOutput.Reset()
+		runBytes(code, make([]byte, memorySize), &byteOutput)
+	}
+	byteTime := time.Since(start) / time.Duration(rounds)
+
+	start = time.Now()
+	for i := 0; i < rounds; i++ {
+		irOutput.Reset()
+		prog, _ = parse(code)
+		run(prog, make([]byte, memorySize), &irOutput)
+	}
+	irTime := time.Since(start) / time.Duration(rounds)
+
+	fmt.Printf("Programa: %d bytes, %d instruções no IR\n", len(code), len(prog))
+	fmt.Printf("byte a byte: %v por execução\n", byteTime)
+	fmt.Printf("IR:          %v por execução (%.1fx)\n", irTime, float64(byteTime)/float64(irTime))
+	if byteOutput.String() != irOutput.String() {
+		fmt.Println("Erro: as saídas dos dois interpretadores diferem")
+		os.Exit(1)
+	}
+}
+
+func main() {
+	rounds := flag.Int("bench", 0, "compara o IR com o interpretador byte a byte em N execuções")
+	flag.Parse()
+
+	code, err := io.ReadAll(os.Stdin)
+	if err != nil {
+		fmt.Println("Erro ao ler entrada:", err)
+		return
+	}
+
+	prog, err := parse(code)
+	if err != nil {
+		fmt.Println("Erro:", err)
+		os.Exit(1)
+	}
+	if *rounds > 0 {
+		benchmark(code, *rounds)
+		return
+	}
+
+	var output strings.Builder
+	run(prog, make([]byte, memorySize), &output)
 
 	text := output.String()
 	if eq := strings.Index(text, "="); eq != -1 && eq+1 < len(text) {